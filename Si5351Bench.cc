@@ -0,0 +1,276 @@
+/*
+ * SI5351 microbenchmarks
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Times the solver, the register encoder and the programming sequences
+ *   and writes the results as JSON, so that builds (-Os against -O2, one
+ *   commit against the next) can be compared:
+ *
+ *     solve/<MHz>          runtime solver for each preset frequency
+ *     plan/3-outputs       dual-PLL planner for a PAL set on three outputs
+ *     encode               P1/P2/P3 encoding and packing of one divider
+ *     configure/clock0     full CLK0 sequence against the simulator
+ *     configure/plan       full multi-output sequence against the simulator
+ *     switch/full          cycling through the presets, full sequence each
+ *     switch/minimal       the same, writing only the changed registers
+ *     trim                 fine trim of PLL A P2 back and forth
+ *
+ *   Every benchmark takes fixed inputs. Its iteration count is doubled
+ *   until one run takes at least the minimum time, then it is run
+ *   repeatedly and the median and fastest time per operation reported.
+ *   The simulator runs without its real-time model, so bus benchmarks
+ *   measure the CPU cost; the bus counters per operation (transfers,
+ *   messages, payload bytes and the on-wire time at 100 kHz) come from
+ *   the bus statistics, as do the system calls, which are 0 for the
+ *   simulator (the i2c-dev transport makes one ioctl() per transfer).
+ *
+ *   Usage: si5351_bench [-o file] [-f filter] [-r repeats] [-m min_ms]
+ */
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Si5351Configuration.h"
+#include "Si5351Presets.h"
+#include "Si5351Simulator.h"
+#include "Si5351Trim.h"
+
+#ifndef SI5351_BENCH_FLAGS
+#define SI5351_BENCH_FLAGS ""
+#endif
+
+#define MAX_RESULTS 64
+#define MAX_REPEATS 99
+#define BUS_HZ 100000
+
+struct Result {
+    char name[32];
+    uint64_t iterations;
+    double medianNs;
+    double minNs;
+    bool bus;
+    double syscalls;            // per operation, as are the rest
+    double transfers;
+    double messages;
+    double bytes;
+    double wireUs;
+};
+
+struct Bench {
+    const char *filter;
+    int repeats;
+    uint64_t minNs;
+    int count;
+    Result results[MAX_RESULTS];
+    Si5351Simulator *simulator;
+    Si5351BusStats stats;
+};
+
+// Results are folded into this so the compiler cannot drop the work
+static volatile uint32_t sink;
+
+/**
+ * Time body(iterations) and record it under name.
+ *
+ * @param bus Whether the body uses the simulator, so bus counters are recorded.
+ */
+template <typename Body>
+static void run(Bench *bench, const char *name, bool bus, Body body) {
+    if ((bench->filter != nullptr && strstr(name, bench->filter) == nullptr) || bench->count == MAX_RESULTS) {
+        return;
+    }
+
+    // Calibrate: double until one run is long enough
+    uint64_t iterations = 1;
+    for (;;) {
+        uint64_t start = monotonicNs();
+        body(iterations);
+        if (monotonicNs() - start >= bench->minNs || iterations >= (1ULL << 40)) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    double samples[MAX_REPEATS];
+    for (int i = 0; i < bench->repeats; i++) {
+        memset(&bench->stats, 0, sizeof(bench->stats));
+        bench->stats.busHz = BUS_HZ;
+        uint64_t start = monotonicNs();
+        body(iterations);
+        samples[i] = (double)(monotonicNs() - start) / iterations;
+    }
+    std::sort(samples, samples + bench->repeats);
+
+    Result &result = bench->results[bench->count++];
+    snprintf(result.name, sizeof(result.name), "%s", name);
+    result.iterations = iterations;
+    result.medianNs = samples[bench->repeats / 2];
+    result.minNs = samples[0];
+    result.bus = bus;
+    const Si5351PhaseStats &total = bench->stats.total;
+    result.syscalls = (double)total.syscalls / iterations;
+    result.transfers = (double)total.transfers / iterations;
+    result.messages = (double)total.messages / iterations;
+    result.bytes = (double)total.bytes / iterations;
+    result.wireUs = total.wireBits * 1e6 / BUS_HZ / iterations;
+    fprintf(stderr, "%-24s %12.1f ns/op\n", name, result.medianNs);
+}
+
+static void runAll(Bench *bench) {
+    static const uint64_t planMilliHz[] = { 1773447000ULL, 3546894000ULL, 14187576000ULL };
+    const int presetCount = sizeof(SI5351_PRESETS) / sizeof(SI5351_PRESETS[0]);
+    Si5351Transport *transport = bench->simulator;
+    char name[32];
+
+    for (const Si5351Preset &preset : SI5351_PRESETS) {
+        snprintf(name, sizeof(name), "solve/%s", preset.name);
+        run(bench, name, false, [&](uint64_t iterations) {
+            Si5351Solution solution;
+            for (uint64_t i = 0; i < iterations; i++) {
+                si5351SolveFrequency(preset.outputMilliHz, SI5351_XTAL_FREQUENCY, 0, &solution);
+                sink = sink + solution.image.pll[7];
+            }
+        });
+    }
+
+    static Si5351Plan plan;
+    run(bench, "plan/3-outputs", false, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            si5351Plan(planMilliHz, 3, SI5351_XTAL_FREQUENCY, &plan);
+            sink = sink + plan.registers[0];
+        }
+    });
+
+    Si5351Divider dividers[sizeof(SI5351_PRESETS) / sizeof(SI5351_PRESETS[0])];
+    for (int i = 0; i < presetCount; i++) {
+        Si5351Solution solution;
+        si5351SolveFrequency(SI5351_PRESETS[i].outputMilliHz, SI5351_XTAL_FREQUENCY, SI5351_PRESETS[i].multiSynth, &solution);
+        dividers[i] = solution.feedback;
+    }
+    run(bench, "encode", false, [&](uint64_t iterations) {
+        uint8_t block[8];
+        for (uint64_t i = 0; i < iterations; i++) {
+            // Through a volatile index, so the encoding is not folded at compile time
+            volatile int index = (int)(i % presetCount);
+            si5351Pack(si5351Encode(dividers[index]), 0, block);
+            sink = sink + block[7];
+        }
+    });
+
+    run(bench, "configure/clock0", true, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            sink = sink + si5351ConfigureClock0(transport, SI5351_PRESETS[4].image);
+        }
+    });
+
+    si5351Plan(planMilliHz, 3, SI5351_XTAL_FREQUENCY, &plan);
+    run(bench, "configure/plan", true, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            sink = sink + si5351ConfigurePlan(transport, plan);
+        }
+    });
+
+    run(bench, "switch/full", true, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            sink = sink + si5351ConfigureClock0(transport, SI5351_PRESETS[i % presetCount].image);
+        }
+    });
+
+    static Si5351RegisterMap maps[sizeof(SI5351_PRESETS) / sizeof(SI5351_PRESETS[0])];
+    static Si5351RegisterMap current;
+    for (int i = 0; i < presetCount; i++) {
+        si5351MapClock0(SI5351_PRESETS[i].image, 0x00, &maps[i]);
+    }
+    run(bench, "switch/minimal", true, [&](uint64_t iterations) {
+        Si5351Update update;
+        memcpy(&current, &maps[presetCount - 1], sizeof(current));
+        for (uint64_t i = 0; i < iterations; i++) {
+            si5351UpdateRegisters(transport, &current, maps[i % presetCount], nullptr, &update);
+            sink = sink + update.written;
+        }
+    });
+
+    run(bench, "trim", true, [&](uint64_t iterations) {
+        Si5351Trim trim;
+        si5351TrimInit(SI5351_PRESETS[4].image, &trim);
+        for (uint64_t i = 0; i < iterations; i++) {
+            sink = sink + si5351Trim(transport, &trim, (i & 1 ? 10 : -10) * trim.ppbPerStep);
+        }
+    });
+}
+
+static void writeJson(FILE *out, const Bench &bench) {
+    fprintf(out, "{\n  \"benchmark\": \"si5351_bench\",\n  \"compiler\": \"%s\",\n  \"flags\": \"%s\",\n", __VERSION__, SI5351_BENCH_FLAGS);
+    fprintf(out, "  \"repeats\": %d,\n  \"bus_hz\": %d,\n  \"results\": [\n", bench.repeats, BUS_HZ);
+    for (int i = 0; i < bench.count; i++) {
+        const Result &result = bench.results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.2f, \"ns_per_op_min\": %.2f", result.name,
+                (unsigned long long)result.iterations, result.medianNs, result.minNs);
+        if (result.bus) {
+            fprintf(out, ", \"syscalls_per_op\": %.3f, \"transfers_per_op\": %.3f, \"messages_per_op\": %.3f, \"bytes_per_op\": %.3f, \"wire_us_per_op\": %.3f",
+                    result.syscalls, result.transfers, result.messages, result.bytes, result.wireUs);
+        }
+        fprintf(out, "}%s\n", i + 1 < bench.count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+static void printUsage(const char *program) {
+    fprintf(stderr, "Usage: %s [-o file] [-f filter] [-r repeats] [-m min_ms]\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    static Bench bench;
+    const char *output = nullptr;
+    bench.repeats = 5;
+    bench.minNs = 20000000;
+
+    int option;
+    while ((option = getopt(argc, argv, "o:f:r:m:")) != -1) {
+        switch (option) {
+        case 'o':
+            output = optarg;
+            break;
+        case 'f':
+            bench.filter = optarg;
+            break;
+        case 'r':
+            bench.repeats = atoi(optarg);
+            break;
+        case 'm':
+            bench.minNs = strtoull(optarg, nullptr, 10) * 1000000ULL;
+            break;
+        default:
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc || bench.repeats < 1 || bench.repeats > MAX_REPEATS) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // No real-time bus model: the bus cost comes from the statistics
+    Si5351Simulator simulator(0);
+    simulator.stats = &bench.stats;
+    bench.simulator = &simulator;
+    runAll(&bench);
+
+    FILE *out = output != nullptr ? fopen(output, "w") : stdout;
+    if (out == nullptr) {
+        perror("Failed to create the output file");
+        return 1;
+    }
+    writeJson(out, bench);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ * SI5351 early-boot configurator
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   A minimal build of the CLK0 programming path for boot scripts on
+ *   small boards, where process startup costs more than the bus. It uses
+ *   the same solver, transport and configuration sequence as
+ *   Si5351ForAtari8bit, but no iostreams, no stdio and no dynamic
+ *   allocation: it is linked statically without libstdc++ and reports
+ *   through write(2) only.
+ *
+ *   Usage: Si5351Boot [--simulate] [--warm] [--lock-deadline <ms>] [preset | <Hz>]
+ *
+ *   The default is the first preset (1.773447 MHz, Atari XL/XE PAL). The
+ *   program exits once the PLL has locked and CLK0 is enabled. With
+ *   --warm, a chip that already runs the configuration is left alone and
+ *   any other only gets the registers that differ.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Si5351Configuration.h"
+#include "Si5351Presets.h"
+#include "Si5351Simulator.h"
+
+// Without libstdc++, the few runtime pieces the compiler still refers to
+extern "C" void __cxa_pure_virtual() {
+    _exit(127);
+}
+
+// Reached only through the deleting destructors; nothing is allocated
+void operator delete(void *) noexcept {
+}
+
+void operator delete(void *, size_t) noexcept {
+}
+
+static void print(int fd, const char *text) {
+    size_t length = strlen(text);
+    while (length > 0) {
+        ssize_t written = write(fd, text, length);
+        if (written <= 0) {
+            return;
+        }
+        text += written;
+        length -= written;
+    }
+}
+
+/**
+ * Format an unsigned number into buffer.
+ *
+ * @return buffer.
+ */
+static const char *decimal(uint32_t value, char *buffer) {
+    char digits[10];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    for (int i = 0; i < count; i++) {
+        buffer[i] = digits[count - 1 - i];
+    }
+    buffer[count] = '\0';
+    return buffer;
+}
+
+int main(int argc, char *argv[]) {
+    const char *target = SI5351_PRESETS[0].name;
+    bool simulate = false;
+    bool warm = false;
+    Si5351Lock lock = {};
+    lock.deadlineUs = SI5351_LOCK_DEADLINE_US;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--simulate") == 0) {
+            simulate = true;
+        } else if (strcmp(argv[i], "--warm") == 0) {
+            warm = true;
+        } else if (strcmp(argv[i], "--lock-deadline") == 0 && i + 1 < argc) {
+            lock.deadlineUs = (uint32_t)strtoul(argv[++i], nullptr, 10) * 1000;
+        } else if (argv[i][0] != '-') {
+            target = argv[i];
+        } else {
+            print(2, "Usage: Si5351Boot [--simulate] [--warm] [--lock-deadline <ms>] [preset | <Hz>]\n");
+            return 1;
+        }
+    }
+
+    Si5351RegisterImage image;
+    const Si5351Preset *preset = si5351FindPreset(target);
+    if (preset != nullptr) {
+        image = preset->image;
+    } else {
+        uint64_t outputMilliHz;
+        Si5351Solution solution;
+        if (si5351ParseMilliHz(target, &outputMilliHz) == -1 ||
+            si5351SolveFrequency(outputMilliHz, SI5351_XTAL_FREQUENCY, 0, &solution) == -1) {
+            print(2, "Not a preset or frequency in range: ");
+            print(2, target);
+            print(2, "\n");
+            return 1;
+        }
+        image = solution.image;
+    }
+
+    Si5351I2cTransport i2c;
+    Si5351Simulator simulator;
+    Si5351Transport *transport = &simulator;
+    if (!simulate) {
+        if (i2c.open() == -1) {
+            return 1;
+        }
+        transport = &i2c;
+    }
+
+    static Si5351RegisterMap map;
+    Si5351WarmStart warmStart;
+    if (warm) {
+        si5351MapClock0(image, 0x00, &map);
+    }
+
+    char number[12];
+    if ((warm ? si5351WarmStart(transport, map, &lock, &warmStart) : si5351ConfigureClock0(transport, image, 0x00, &lock)) == -1) {
+        if (lock.timedOut) {
+            print(2, "PLL not locked after ");
+            print(2, decimal(lock.lockUs, number));
+            print(2, " us, outputs left disabled.\n");
+        } else {
+            print(2, "Register write error.\n");
+        }
+        return 1;
+    }
+
+    print(1, warm && warmStart.untouched ? "CLK0 already at " : "CLK0 set to ");
+    print(1, target);
+    print(1, preset != nullptr ? " MHz" : " Hz");
+    if (warm && !warmStart.untouched) {
+        print(1, ", ");
+        print(1, decimal(warmStart.update.written, number));
+        print(1, " registers rewritten");
+    }
+    if (lock.locked) {
+        print(1, ", locked after ");
+        print(1, decimal(lock.lockUs, number));
+        print(1, " us");
+    }
+    print(1, ".\n");
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*
+ * SI5351 crystal calibration
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Si5351Calibration.h"
+#include "Si5351Presets.h"
+
+#define PRESET_COUNT (sizeof(SI5351_PRESETS) / sizeof(SI5351_PRESETS[0]))
+
+/**
+ * Read the first line of a file, without the newline and trailing NULs.
+ *
+ * @return 0 on success, -1 if the file is missing or empty.
+ */
+static int readFirstLine(const char *path, char *text, size_t size) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        return -1;
+    }
+    size_t length = fread(text, 1, size - 1, file);
+    fclose(file);
+    text[length] = '\0';
+    text[strcspn(text, "\r\n")] = '\0';
+    return text[0] == '\0' ? -1 : 0;
+}
+
+int si5351BoardId(char *id, size_t size) {
+    if (readFirstLine("/proc/device-tree/serial-number", id, size) == -1 &&
+        readFirstLine("/etc/machine-id", id, size) == -1 && (gethostname(id, size) != 0 || id[0] == '\0')) {
+        return -1;
+    }
+    id[size - 1] = '\0';
+    for (char *c = id; *c != '\0'; c++) {
+        if (strchr("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789.-_", *c) == nullptr) {
+            *c = '_';
+        }
+    }
+    return 0;
+}
+
+/**
+ * Read a crystal frequency in Hz or a correction in ppm ("-18.5ppm").
+ *
+ * @return 0 on success, -1 if the text is neither or out of a sane range.
+ */
+static int parseCrystal(const char *text, uint64_t *xtalHz) {
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text) {
+        return -1;
+    }
+    double hz = strcmp(end, "ppm") == 0 ? SI5351_XTAL_FREQUENCY * (1 + value / 1e6) : *end == '\0' ? value : -1;
+
+    // A crystal more than 1000 ppm off is a typo, not a measurement
+    if (hz < SI5351_XTAL_FREQUENCY * 0.999 || hz > SI5351_XTAL_FREQUENCY * 1.001) {
+        return -1;
+    }
+    *xtalHz = (uint64_t)llround(hz);
+    return 0;
+}
+
+int si5351LoadCalibration(const char *path, const char *board, uint64_t *xtalHz) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        perror("Failed to open the calibration table");
+        return -1;
+    }
+
+    char line[256];
+    int lineNumber = 0;
+    int result = 0;
+    while (result == 0 && fgets(line, sizeof(line), file) != nullptr) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment != nullptr) {
+            *comment = '\0';
+        }
+        char *id = strtok(line, " \t\r\n");
+        char *crystal = strtok(nullptr, " \t\r\n");
+        if (id == nullptr) {
+            continue;
+        }
+        if (crystal == nullptr || strtok(nullptr, " \t\r\n") != nullptr || parseCrystal(crystal, xtalHz) == -1) {
+            fprintf(stderr, "%s:%d: expected <board> <crystal Hz | correction ppm>\n", path, lineNumber);
+            result = -1;
+        } else if (strcmp(id, board) == 0) {
+            result = 1;
+        }
+    }
+
+    fclose(file);
+    return result;
+}
+
+void si5351CalibrationCachePath(const char *dir, const char *board, uint64_t xtalHz, char *path, size_t size) {
+    snprintf(path, size, "%s/%s-%llu.s535", dir, board, (unsigned long long)xtalHz);
+}
+
+void si5351FrequencyName(uint64_t outputMilliHz, char *name, size_t size) {
+    int length = snprintf(name, size, "%llu.%03u", (unsigned long long)(outputMilliHz / 1000), (unsigned)(outputMilliHz % 1000));
+    while (length > 0 && (size_t)length < size && (name[length - 1] == '0' || name[length - 1] == '.')) {
+        bool point = name[--length] == '.';
+        name[length] = '\0';
+        if (point) {
+            break;
+        }
+    }
+}
+
+int si5351WriteCalibrationCache(const char *path, uint64_t xtalHz, const uint64_t *customMilliHz, int customCount) {
+    static char names[SI5351_STORE_MAX_PRESETS][SI5351_STORE_NAME_LENGTH];
+    static const char *namePointers[SI5351_STORE_MAX_PRESETS];
+    static Si5351RegisterMap maps[SI5351_STORE_MAX_PRESETS];
+    int count = 0;
+
+    if (PRESET_COUNT + customCount > SI5351_STORE_MAX_PRESETS) {
+        fprintf(stderr, "%s: too many frequencies\n", path);
+        return -1;
+    }
+
+    // The presets keep their MultiSynth divider, so only PLL A moves
+    for (const Si5351Preset &preset : SI5351_PRESETS) {
+        Si5351Solution solution;
+        if (si5351SolveFrequency(preset.outputMilliHz, xtalHz, preset.multiSynth, &solution) == -1) {
+            fprintf(stderr, "%s MHz: out of range with a %llu Hz crystal\n", preset.name, (unsigned long long)xtalHz);
+            return -1;
+        }
+        snprintf(names[count], SI5351_STORE_NAME_LENGTH, "%s", preset.name);
+        si5351MapClock0(solution.image, 0x00, &maps[count++]);
+    }
+    for (int i = 0; i < customCount; i++) {
+        Si5351Solution solution;
+        si5351FrequencyName(customMilliHz[i], names[count], SI5351_STORE_NAME_LENGTH);
+        if (si5351SolveFrequency(customMilliHz[i], xtalHz, 0, &solution) == -1) {
+            fprintf(stderr, "%s Hz: out of range with a %llu Hz crystal\n", names[count], (unsigned long long)xtalHz);
+            return -1;
+        }
+        si5351MapClock0(solution.image, 0x00, &maps[count++]);
+    }
+
+    for (int i = 0; i < count; i++) {
+        namePointers[i] = names[i];
+    }
+    return si5351WriteStore(path, namePointers, maps, count) == -1 ? -1 : count;
+}
+
+int si5351CalibratedPreset(const char *path, uint64_t xtalHz, const char *target, Si5351Store *store,
+                           const Si5351StoreEntry **entry, int *solved) {
+    static uint64_t customMilliHz[SI5351_STORE_MAX_PRESETS];
+    char name[SI5351_STORE_NAME_LENGTH];
+    int customCount = 0;
+    uint64_t targetMilliHz = 0;
+
+    // Presets by name, other frequencies by their canonical text
+    if (si5351FindPreset(target) != nullptr) {
+        snprintf(name, sizeof(name), "%s", target);
+    } else if (si5351ParseMilliHz(target, &targetMilliHz) == 0) {
+        si5351FrequencyName(targetMilliHz, name, sizeof(name));
+    } else {
+        fprintf(stderr, "%s: not a preset or frequency\n", target);
+        return -1;
+    }
+
+    *solved = 0;
+    bool cached = access(path, F_OK) == 0 && si5351OpenStore(path, store) == 0;
+    if (cached) {
+        *entry = si5351FindStoredPreset(*store, name);
+        if (*entry != nullptr) {
+            return 0;
+        }
+
+        // Keep the custom frequencies solved before
+        for (int i = 0; i < store->header->presetCount; i++) {
+            uint64_t milliHz;
+            if (si5351FindPreset(store->entries[i].name) == nullptr && si5351ParseMilliHz(store->entries[i].name, &milliHz) == 0) {
+                customMilliHz[customCount++] = milliHz;
+            }
+        }
+        si5351CloseStore(store);
+    }
+    if (targetMilliHz != 0 && customCount < SI5351_STORE_MAX_PRESETS) {
+        customMilliHz[customCount++] = targetMilliHz;
+    }
+
+    // The directory may not exist on the first start
+    const char *slash = strrchr(path, '/');
+    if (slash != nullptr) {
+        char dir[256];
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+        if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+            perror("Failed to create the calibration cache directory");
+            return -1;
+        }
+    }
+    *solved = si5351WriteCalibrationCache(path, xtalHz, customMilliHz, customCount);
+    if (*solved == -1 || si5351OpenStore(path, store) == -1) {
+        return -1;
+    }
+    *entry = si5351FindStoredPreset(*store, name);
+    if (*entry == nullptr) {
+        si5351CloseStore(store);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * SI5351 crystal calibration
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   The presets assume a crystal of exactly 25 MHz; real ones are off by
+ *   10-30 ppm, and the output with them. A calibration table gives the
+ *   measured crystal of each board, as a frequency or a correction:
+ *
+ *     # board           crystal
+ *     00000000a1b2c3d4  25000312
+ *     pi-zero-2         -18.5ppm
+ *
+ *   For a listed board every preset (with its own MultiSynth divider) and
+ *   every custom frequency asked for so far are solved against the
+ *   corrected crystal in one batch. The register images are kept in a
+ *   preset store (Si5351PresetStore.h) named after the board and the
+ *   crystal, so later starts program them without solving, and a new
+ *   measurement starts a new cache. The corrected crystal is rounded to
+ *   1 Hz (0.04 ppm), as the solver takes whole hertz.
+ */
+
+#ifndef SI5351_CALIBRATION_H
+#define SI5351_CALIBRATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Si5351PresetStore.h"
+
+#define SI5351_CALIBRATION_CACHE_DIR "/var/cache/si5351"
+#define SI5351_BOARD_ID_LENGTH 64
+
+/**
+ * Identify this board: the device-tree serial number (Raspberry Pi),
+ * else /etc/machine-id, else the host name. Characters other than
+ * letters, digits, '.', '-' and '_' are replaced by '_'.
+ *
+ * @return 0 on success, -1 if none is available.
+ */
+int si5351BoardId(char *id, size_t size);
+
+/**
+ * Look up a board in a calibration table.
+ *
+ * @param path The calibration table.
+ * @param board The board ID.
+ * @param xtalHz Receives the corrected crystal frequency.
+ * @return 1 if the board is listed, 0 if not, -1 if the table cannot be read or is invalid.
+ */
+int si5351LoadCalibration(const char *path, const char *board, uint64_t *xtalHz);
+
+/**
+ * Path of the cache for a board and crystal: "<dir>/<board>-<xtalHz>.s535".
+ */
+void si5351CalibrationCachePath(const char *dir, const char *board, uint64_t xtalHz, char *path, size_t size);
+
+/**
+ * Name of a custom frequency in the cache: hertz with up to three
+ * decimals and no trailing zeros, e.g. "1995000.5".
+ */
+void si5351FrequencyName(uint64_t outputMilliHz, char *name, size_t size);
+
+/**
+ * Solve every preset and the given custom frequencies against a crystal
+ * and write them to a preset store.
+ *
+ * @param path The cache file to create or replace.
+ * @param xtalHz The corrected crystal frequency.
+ * @param customMilliHz Custom frequencies to add.
+ * @param customCount How many.
+ * @return Number of register images written, or -1 on failure.
+ */
+int si5351WriteCalibrationCache(const char *path, uint64_t xtalHz, const uint64_t *customMilliHz, int customCount);
+
+/**
+ * Open a board's cache and find a preset or frequency in it. If the
+ * cache is missing or does not hold the target, it is solved again in
+ * one batch with the target and the custom frequencies it held.
+ *
+ * @param path The cache file.
+ * @param xtalHz The corrected crystal frequency.
+ * @param target A preset name or a frequency in Hz.
+ * @param store Receives the mapped cache; close it with si5351CloseStore().
+ * @param entry Receives the target's entry.
+ * @param solved Receives the number of images solved, 0 on a cache hit.
+ * @return 0 on success, -1 on failure or a target out of range.
+ */
+int si5351CalibratedPreset(const char *path, uint64_t xtalHz, const char *target, Si5351Store *store,
+                           const Si5351StoreEntry **entry, int *solved);
+
+#endif // SI5351_CALIBRATION_H
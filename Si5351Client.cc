@@ -0,0 +1,112 @@
+/*
+ * SI5351 daemon client
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Sends one command to the Si5351ForAtari8bit daemon and prints the
+ *   reply. With -n the command is repeated over the same connection and
+ *   round-trip latency percentiles are printed as well.
+ *
+ *   Usage: Si5351Client [-s socket] [-n count] command [argument]
+ */
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Si5351Daemon.h"
+
+#define MAX_REPEAT 100000
+
+/**
+ * Read one reply line from the daemon.
+ *
+ * @return Length of the line without the newline, or -1 on failure.
+ */
+static int readLine(int fd, char *line, int size) {
+    int length = 0;
+    while (length < size - 1) {
+        if (read(fd, line + length, 1) != 1) {
+            return -1;
+        }
+        if (line[length] == '\n') {
+            break;
+        }
+        length++;
+    }
+    line[length] = '\0';
+    return length;
+}
+
+int main(int argc, char *argv[]) {
+    const char *socketPath = SI5351_DAEMON_SOCKET;
+    int count = 1;
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        } else {
+            break;
+        }
+    }
+    if (i >= argc || count < 1 || count > MAX_REPEAT) {
+        fprintf(stderr, "Usage: %s [-s socket] [-n count] command [argument]\n", argv[0]);
+        return 1;
+    }
+
+    char command[SI5351_DAEMON_MAX_LINE];
+    int length = 0;
+    for (; i < argc; i++) {
+        length += snprintf(command + length, sizeof(command) - length, "%s%s", length ? " " : "", argv[i]);
+        if (length >= (int)sizeof(command) - 1) {
+            fprintf(stderr, "Command too long\n");
+            return 1;
+        }
+    }
+    command[length++] = '\n';
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror("Failed to connect to the daemon");
+        return 1;
+    }
+
+    static float latency[MAX_REPEAT];
+    char reply[512];
+    for (int n = 0; n < count; n++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (write(fd, command, length) != length || readLine(fd, reply, sizeof(reply)) < 0) {
+            perror("Daemon connection lost");
+            close(fd);
+            return 1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        latency[n] = (end.tv_sec - start.tv_sec) * 1e6f + (end.tv_nsec - start.tv_nsec) / 1e3f;
+    }
+    close(fd);
+
+    printf("%s\n", reply);
+    if (count > 1) {
+        std::sort(latency, latency + count);
+        printf("round trip (us): n=%d p50=%.1f p90=%.1f p99=%.1f max=%.1f\n", count, latency[count * 50 / 100],
+               latency[count * 90 / 100], latency[count * 99 / 100], latency[count - 1]);
+    }
+
+    return strncmp(reply, "OK", 2) == 0 ? 0 : 1;
+}
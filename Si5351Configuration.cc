@@ -0,0 +1,360 @@
+/*
+ * SI5351 configuration sequence
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "Si5351Configuration.h"
+
+int si5351WaitForLock(Si5351Transport *transport, uint8_t statusMask, uint64_t startNs, Si5351Lock *lock) {
+    uint64_t deadline = startNs + lock->deadlineUs * 1000ULL;
+    uint32_t intervalUs = 0;
+
+    lock->locked = false;
+    lock->timedOut = false;
+    lock->polls = 0;
+    for (;;) {
+        if (transport->readBlock(SI5351_REGISTER_0_DEVICE_STATUS, &lock->status, 1, SI5351_PHASE_LOCK) == -1) {
+            return -1;
+        }
+        lock->polls++;
+
+        uint64_t now = monotonicNs();
+        lock->lockUs = (uint32_t)((now - startNs) / 1000);
+        if ((lock->status & statusMask) == 0) {
+            lock->locked = true;
+            return 0;
+        }
+        if (now >= deadline) {
+            lock->timedOut = true;
+            return -1;
+        }
+
+        // Back off, but never sleep past the deadline
+        uint64_t wake = now + intervalUs * 1000ULL;
+        if (wake > deadline) {
+            wake = deadline;
+        }
+        struct timespec until;
+        until.tv_sec = wake / 1000000000ULL;
+        until.tv_nsec = wake % 1000000000ULL;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr);
+        intervalUs = intervalUs == 0 ? SI5351_LOCK_POLL_MIN_US : intervalUs * 2;
+        if (intervalUs > SI5351_LOCK_POLL_MAX_US) {
+            intervalUs = SI5351_LOCK_POLL_MAX_US;
+        }
+    }
+}
+
+/**
+ * Send a sequence whose last block is the output enable, waiting for lock
+ * in between if asked to.
+ */
+static int configure(Si5351Transport *transport, const RegisterBlock *blocks, int count, uint8_t statusMask, Si5351Lock *lock) {
+    if (lock == nullptr || lock->deadlineUs == 0) {
+        return transport->writeBlocks(blocks, count);
+    }
+
+    int sent = transport->writeBlocks(blocks, count - 1);
+    if (sent == -1 || si5351WaitForLock(transport, statusMask, monotonicNs(), lock) == -1) {
+        return -1;
+    }
+    int enabled = transport->writeBlocks(blocks + count - 1, 1);
+    return enabled == -1 ? -1 : sent + enabled;
+}
+
+uint8_t si5351LockMask(const Si5351RegisterMap &map) {
+    uint8_t mask = SI5351_STATUS_SYS_INIT;
+    for (int reg = SI5351_REGISTER_16_CLK0_CONTROL; reg <= SI5351_REGISTER_23_CLK7_CONTROL; reg++) {
+        if (si5351MapDefined(map, reg) && !(map.values[reg] & 0x80)) {
+            mask |= map.values[reg] & SI5351_CLK_CONTROL_PLL_B ? SI5351_STATUS_LOL_B : SI5351_STATUS_LOL_A;
+        }
+    }
+    return mask;
+}
+
+void si5351MapClock0(const Si5351RegisterImage &image, uint8_t outputEnable, Si5351RegisterMap *map) {
+    memset(map, 0, sizeof(*map));
+
+    // Enable desired outputs
+    si5351MapSet(map, SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, outputEnable);
+
+    // Powerup only output #0 (CLK0..CLK7 control, CLK3..0 and CLK7..4 disable state)
+    si5351MapSet(map, SI5351_REGISTER_16_CLK0_CONTROL, image.clockControl);
+    for (int reg = SI5351_REGISTER_17_CLK1_CONTROL; reg <= SI5351_REGISTER_23_CLK7_CONTROL; reg++) {
+        si5351MapSet(map, reg, 0x80);
+    }
+    si5351MapSet(map, SI5351_REGISTER_24_CLK3_0_DISABLE_STATE, 0x00);
+    si5351MapSet(map, SI5351_REGISTER_25_CLK7_4_DISABLE_STATE, 0x00);
+
+    for (int i = 0; i < 8; i++) {
+        si5351MapSet(map, SI5351_REGISTER_26_PLL_A_REG0 + i, image.pll[i]);
+        si5351MapSet(map, SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1 + i, image.multiSynth[i]);
+    }
+}
+
+void si5351MapPlan(const Si5351Plan &plan, Si5351RegisterMap *map) {
+    memset(map, 0, sizeof(*map));
+    si5351MapSet(map, SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, plan.outputEnable);
+    for (int i = 0; i < SI5351_PLAN_REGISTER_COUNT; i++) {
+        si5351MapSet(map, SI5351_PLAN_FIRST_REGISTER + i, plan.registers[i]);
+    }
+}
+
+int si5351ConfigureClock0(Si5351Transport *transport, const Si5351RegisterImage &image, uint8_t outputEnable, Si5351Lock *lock) {
+    Si5351RegisterMap map;
+    si5351MapClock0(image, outputEnable, &map);
+
+    // Disable Outputs
+    const uint8_t disableOutputs[1] = { 0xFF };
+
+    // Apply PLLA and PLLB soft reset
+    const uint8_t pllReset[1] = { 0xAC };
+
+    const RegisterBlock configuration[] = {
+        { SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 1, disableOutputs, SI5351_PHASE_DISABLE },
+        { SI5351_REGISTER_16_CLK0_CONTROL, 10, map.values + SI5351_REGISTER_16_CLK0_CONTROL, SI5351_PHASE_CLOCK_CONTROL },
+        { SI5351_REGISTER_26_PLL_A_REG0, 8, map.values + SI5351_REGISTER_26_PLL_A_REG0, SI5351_PHASE_PLL },
+        { SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, 8, map.values + SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, SI5351_PHASE_MULTISYNTH },
+        { SI5351_REGISTER_177_PLL_RESET, 1, pllReset, SI5351_PHASE_RESET },
+        { SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 1, map.values + SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, SI5351_PHASE_ENABLE },
+    };
+
+    return configure(transport, configuration, sizeof(configuration) / sizeof(configuration[0]),
+                     SI5351_STATUS_SYS_INIT | SI5351_STATUS_LOL_A, lock);
+}
+
+int si5351ConfigurePlan(Si5351Transport *transport, const Si5351Plan &plan, Si5351Lock *lock) {
+    Si5351RegisterMap map;
+    si5351MapPlan(plan, &map);
+
+    const uint8_t disableOutputs[1] = { 0xFF };
+    const uint8_t pllReset[1] = { 0xAC };
+
+    // Registers 16-92 in one message, split only for the statistics
+    const RegisterBlock configuration[] = {
+        { SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 1, disableOutputs, SI5351_PHASE_DISABLE },
+        { SI5351_REGISTER_16_CLK0_CONTROL, SI5351_REGISTER_26_PLL_A_REG0 - SI5351_REGISTER_16_CLK0_CONTROL,
+          map.values + SI5351_REGISTER_16_CLK0_CONTROL, SI5351_PHASE_CLOCK_CONTROL },
+        { SI5351_REGISTER_26_PLL_A_REG0, SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1 - SI5351_REGISTER_26_PLL_A_REG0,
+          map.values + SI5351_REGISTER_26_PLL_A_REG0, SI5351_PHASE_PLL },
+        { SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, SI5351_PLAN_LAST_REGISTER + 1 - SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1,
+          map.values + SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, SI5351_PHASE_MULTISYNTH },
+        { SI5351_REGISTER_177_PLL_RESET, 1, pllReset, SI5351_PHASE_RESET },
+        { SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 1, map.values + SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, SI5351_PHASE_ENABLE },
+    };
+    uint8_t statusMask = SI5351_STATUS_SYS_INIT;
+    if (plan.pllUsed & 1) {
+        statusMask |= SI5351_STATUS_LOL_A;
+    }
+    if (plan.pllUsed & 2) {
+        statusMask |= SI5351_STATUS_LOL_B;
+    }
+
+    return configure(transport, configuration, sizeof(configuration) / sizeof(configuration[0]), statusMask, lock);
+}
+
+/**
+ * The statistics phase of a register written by an update.
+ */
+static uint8_t updatePhase(int reg) {
+    if (reg >= SI5351_REGISTER_16_CLK0_CONTROL && reg < SI5351_REGISTER_26_PLL_A_REG0) {
+        return SI5351_PHASE_CLOCK_CONTROL;
+    }
+    if (reg >= SI5351_REGISTER_26_PLL_A_REG0 && reg < SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1) {
+        return SI5351_PHASE_PLL;
+    }
+    if (reg >= SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1 && reg <= SI5351_PLAN_LAST_REGISTER) {
+        return SI5351_PHASE_MULTISYNTH;
+    }
+    return SI5351_PHASE_OTHER;
+}
+
+/**
+ * Write blocks in as many transfers as the message limit needs.
+ *
+ * @return Number of messages sent, or -1 on failure.
+ */
+static int writeBatched(Si5351Transport *transport, const RegisterBlock *blocks, int count, Si5351Update *update) {
+    int sent = 0;
+    int first = 0;
+    while (first < count) {
+        // Take blocks until one more would start a message over the limit
+        int messages = 0;
+        int end = first;
+        int length = 0;
+        for (; end < count; end++) {
+            bool continues = end > first && blocks[end].reg == blocks[end - 1].reg + blocks[end - 1].length &&
+                             length + blocks[end].length <= I2C_MAX_BURST;
+            if (!continues) {
+                if (messages == I2C_MAX_MESSAGES) {
+                    break;
+                }
+                messages++;
+                length = 0;
+            }
+            length += blocks[end].length;
+        }
+        int result = transport->writeBlocks(blocks + first, end - first);
+        if (result == -1) {
+            return -1;
+        }
+        sent += result;
+        update->transfers++;
+        first = end;
+    }
+    return sent;
+}
+
+int si5351UpdateRegisters(Si5351Transport *transport, Si5351RegisterMap *current, const Si5351RegisterMap &target,
+                          Si5351Lock *lock, Si5351Update *update) {
+    static const uint8_t disableOutputs[1] = { 0xFF };
+    uint8_t pllReset[1] = { 0 };
+    RegisterBlock blocks[2 + 256];
+    int count = 0;
+    uint8_t statusMask = SI5351_STATUS_SYS_INIT;
+    bool enableChanged = false;
+
+    memset(update, 0, sizeof(*update));
+    for (int reg = 0; reg < 256; reg++) {
+        if (!si5351MapDefined(target, reg) ||
+            (si5351MapDefined(*current, reg) && current->values[reg] == target.values[reg])) {
+            continue;
+        }
+        update->changed++;
+        if (reg >= SI5351_REGISTER_26_PLL_A_REG0 && reg <= SI5351_REGISTER_41_PLL_B_REG7) {
+            update->pllReset = true;
+            statusMask |= reg < SI5351_REGISTER_34_PLL_B_REG0 ? SI5351_STATUS_LOL_A : SI5351_STATUS_LOL_B;
+        }
+        if (reg == SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL) {
+            enableChanged = true;
+        }
+    }
+    if (update->changed == 0) {
+        return 0;
+    }
+
+    if (update->pllReset) {
+        blocks[count++] = RegisterBlock{ SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 1, disableOutputs, SI5351_PHASE_DISABLE };
+    }
+    for (int reg = 0; reg < 256; reg++) {
+        if (reg == SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL || reg == SI5351_REGISTER_177_PLL_RESET ||
+            !si5351MapDefined(target, reg) ||
+            (si5351MapDefined(*current, reg) && current->values[reg] == target.values[reg])) {
+            continue;
+        }
+
+        // Extend the last block over a short gap of registers the target defines
+        RegisterBlock *last = count > 0 ? &blocks[count - 1] : nullptr;
+        int gapEnd = last != nullptr ? last->reg + last->length : 0;
+        bool bridge = last != nullptr && last->phase == updatePhase(reg) && reg - gapEnd <= SI5351_UPDATE_MERGE_GAP;
+        for (int gap = gapEnd; bridge && gap < reg; gap++) {
+            bridge = si5351MapDefined(target, gap);
+        }
+        if (bridge && reg - last->reg + 1 <= I2C_MAX_BURST) {
+            update->written += reg - gapEnd + 1;
+            last->length = reg - last->reg + 1;
+        } else {
+            blocks[count++] = RegisterBlock{ (uint8_t)reg, 1, target.values + reg, updatePhase(reg) };
+            update->written++;
+        }
+    }
+
+    uint8_t outputEnable = si5351MapDefined(target, SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL)
+                               ? target.values[SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL]
+                               : 0x00;
+    if (update->pllReset) {
+        // Reset only the PLLs that changed
+        pllReset[0] = (uint8_t)((statusMask & SI5351_STATUS_LOL_A ? SI5351_PLL_RESET_A : 0) |
+                                (statusMask & SI5351_STATUS_LOL_B ? SI5351_PLL_RESET_B : 0));
+        blocks[count++] = RegisterBlock{ SI5351_REGISTER_177_PLL_RESET, 1, pllReset, SI5351_PHASE_RESET };
+    }
+    if (update->pllReset || enableChanged) {
+        blocks[count++] = RegisterBlock{ SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 1, &outputEnable, SI5351_PHASE_ENABLE };
+    }
+
+    // As in configure(), the enable waits for lock only after a PLL reset
+    bool wait = update->pllReset && lock != nullptr && lock->deadlineUs != 0;
+    int sent = writeBatched(transport, blocks, wait ? count - 1 : count, update);
+    int result = sent == -1 ? -1 : 0;
+    if (result == 0 && wait) {
+        si5351MapSet(current, SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, disableOutputs[0]);
+        result = si5351WaitForLock(transport, statusMask, monotonicNs(), lock);
+        int enabled = result == 0 ? writeBatched(transport, blocks + count - 1, 1, update) : 0;
+        if (enabled == -1) {
+            result = -1;
+        } else {
+            sent += enabled;
+        }
+    }
+    update->messages = sent == -1 ? 0 : sent;
+
+    if (result == -1 && !(wait && lock->timedOut)) {
+        // Bus failure: what the chip holds is unknown
+        memset(current, 0, sizeof(*current));
+        return -1;
+    }
+    for (int reg = 0; reg < 256; reg++) {
+        if (si5351MapDefined(target, reg) && reg != SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL &&
+            reg != SI5351_REGISTER_177_PLL_RESET) {
+            si5351MapSet(current, reg, target.values[reg]);
+        }
+    }
+    if (result == 0 && (update->pllReset || enableChanged)) {
+        si5351MapSet(current, SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, outputEnable);
+    }
+    return result;
+}
+
+int si5351WarmStart(Si5351Transport *transport, const Si5351RegisterMap &target, Si5351Lock *lock, Si5351WarmStart *result) {
+    static Si5351RegisterMap current;
+    uint8_t actual[256];
+    RegisterRead reads[128];
+    int readCount = 0;
+
+    memset(result, 0, sizeof(*result));
+
+    // Register 0 and the defined registers; short gaps are read rather than split
+    for (int reg = 0; reg < 256; reg++) {
+        if (reg != SI5351_REGISTER_0_DEVICE_STATUS && !si5351MapDefined(target, reg)) {
+            continue;
+        }
+        RegisterRead *last = readCount > 0 ? &reads[readCount - 1] : nullptr;
+        if (last != nullptr && reg - (last->reg + last->length) <= SI5351_UPDATE_MERGE_GAP && reg - last->reg < I2C_MAX_BURST) {
+            last->length = (uint8_t)(reg - last->reg + 1);
+        } else {
+            reads[readCount++] = RegisterRead{ (uint8_t)reg, 1, actual + reg };
+        }
+        result->registers += reg != SI5351_REGISTER_0_DEVICE_STATUS;
+    }
+    result->readTransfers = transport->readBlocks(reads, readCount, SI5351_PHASE_VERIFY);
+    if (result->readTransfers == -1) {
+        return -1;
+    }
+
+    memset(&current, 0, sizeof(current));
+    for (int reg = 0; reg < 256; reg++) {
+        if (si5351MapDefined(target, reg)) {
+            si5351MapSet(&current, reg, actual[reg]);
+            result->mismatched += actual[reg] != target.values[reg];
+        }
+    }
+    result->status = actual[SI5351_REGISTER_0_DEVICE_STATUS];
+    result->unlocked = (result->status & si5351LockMask(target)) != 0;
+    if (result->mismatched == 0 && !result->unlocked) {
+        result->untouched = true;
+        return 0;
+    }
+
+    // A PLL that is not locked is reset, even if its registers are right
+    if (result->unlocked) {
+        for (int reg = SI5351_REGISTER_26_PLL_A_REG0; reg <= SI5351_REGISTER_41_PLL_B_REG7; reg++) {
+            current.defined[reg >> 3] &= ~(1 << (reg & 7));
+        }
+    }
+    return si5351UpdateRegisters(transport, &current, target, lock, &result->update);
+}
@@ -0,0 +1,175 @@
+/*
+ * SI5351 configuration sequence
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#ifndef SI5351_CONFIGURATION_H
+#define SI5351_CONFIGURATION_H
+
+#include "Si5351Planner.h"
+#include "Si5351Solver.h"
+#include "Si5351Transport.h"
+
+#define SI5351_LOCK_DEADLINE_US 100000
+#define SI5351_LOCK_POLL_MIN_US 50
+#define SI5351_LOCK_POLL_MAX_US 1000
+
+// Unchanged registers at most this far apart are rewritten to save a message
+#define SI5351_UPDATE_MERGE_GAP 2
+
+/**
+ * The register values a configuration leaves in the chip, and which
+ * registers it defines.
+ */
+struct Si5351RegisterMap {
+    uint8_t values[256];
+    uint8_t defined[32];        // bit per register
+};
+
+inline void si5351MapSet(Si5351RegisterMap *map, uint8_t reg, uint8_t value) {
+    map->values[reg] = value;
+    map->defined[reg >> 3] |= 1 << (reg & 7);
+}
+
+inline bool si5351MapDefined(const Si5351RegisterMap &map, uint8_t reg) {
+    return map.defined[reg >> 3] & (1 << (reg & 7));
+}
+
+/**
+ * Register map left by si5351ConfigureClock0(): output enable, CLK
+ * control and disable state, PLL A and MultiSynth0.
+ */
+void si5351MapClock0(const Si5351RegisterImage &image, uint8_t outputEnable, Si5351RegisterMap *map);
+
+/**
+ * Register map left by si5351ConfigurePlan(): output enable and
+ * registers 16-92.
+ */
+void si5351MapPlan(const Si5351Plan &plan, Si5351RegisterMap *map);
+
+/**
+ * Register 0 bits that must be clear for a register map to be running:
+ * SYS_INIT and LOL of the PLLs its powered-up outputs use (MS_SRC).
+ */
+uint8_t si5351LockMask(const Si5351RegisterMap &map);
+
+/**
+ * Waiting for the PLLs to lock after a reset.
+ */
+struct Si5351Lock {
+    uint32_t deadlineUs;        // in: give up after this long, 0 = do not wait
+    bool locked;                // out: SYS_INIT and LOL of the used PLLs cleared
+    bool timedOut;              // out: the deadline passed first
+    uint8_t status;             // out: last value of register 0
+    uint32_t lockUs;            // out: from the PLL reset to the poll that saw lock
+    uint32_t polls;             // out: status reads made
+};
+
+/**
+ * Poll register 0 with 1-byte combined write/read transfers until the
+ * bits in statusMask are clear or the deadline passes. Polls start back
+ * to back and back off from SI5351_LOCK_POLL_MIN_US to
+ * SI5351_LOCK_POLL_MAX_US between reads.
+ *
+ * @param transport The bus to the chip.
+ * @param statusMask Register 0 bits that must clear, e.g. SYS_INIT | LOL_A.
+ * @param startNs CLOCK_MONOTONIC time the wait is measured from.
+ * @param lock Holds the deadline and receives the result.
+ * @return 0 if the bits cleared, -1 on timeout or bus failure.
+ */
+int si5351WaitForLock(Si5351Transport *transport, uint8_t statusMask, uint64_t startNs, Si5351Lock *lock);
+
+/**
+ * Program CLK0 from a register image: disable the outputs, power up only
+ * CLK0, write PLL A and MultiSynth0, reset the PLLs and set the output
+ * enable register.
+ *
+ * Without a lock wait everything goes out in one transfer. With one, the
+ * output enable is written only after PLL A has locked; on timeout the
+ * outputs stay disabled.
+ *
+ * @param transport The bus to the chip.
+ * @param image The register image to program.
+ * @param outputEnable Value for register 3 afterwards (a set bit disables that output).
+ * @param lock If not nullptr and its deadline is set, wait for lock before enabling.
+ * @return Number of I2C messages sent, or -1 on failure or lock timeout.
+ */
+int si5351ConfigureClock0(Si5351Transport *transport, const Si5351RegisterImage &image, uint8_t outputEnable = 0x00,
+                          Si5351Lock *lock = nullptr);
+
+/**
+ * Program a multi-output plan: disable the outputs, write registers 16-92,
+ * reset the PLLs and enable the planned outputs, waiting for the used
+ * PLLs to lock first as in si5351ConfigureClock0().
+ *
+ * @param transport The bus to the chip.
+ * @param plan The plan from si5351Plan().
+ * @param lock If not nullptr and its deadline is set, wait for lock before enabling.
+ * @return Number of I2C messages sent, or -1 on failure or lock timeout.
+ */
+int si5351ConfigurePlan(Si5351Transport *transport, const Si5351Plan &plan, Si5351Lock *lock = nullptr);
+
+/**
+ * What si5351UpdateRegisters() wrote.
+ */
+struct Si5351Update {
+    int changed;                // registers that differed
+    int written;                // registers written, including merged gaps
+    int messages;               // I2C messages sent
+    int transfers;              // combined transfers
+    bool pllReset;
+};
+
+/**
+ * Move the chip from one register map to another, writing only the
+ * registers that differ. Changed registers at most SI5351_UPDATE_MERGE_GAP
+ * apart share one block. Only if a PLL register (26-41) changed are the
+ * outputs disabled, the changed PLLs reset and, with a lock deadline,
+ * waited for before the output enable is written; a MultiSynth or
+ * CLK control change goes out as one transfer without a reset.
+ *
+ * @param transport The bus to the chip.
+ * @param current What the chip holds; a register it does not define is
+ *                written. Updated to what the chip holds afterwards, and
+ *                cleared if a transfer failed.
+ * @param target The register map to program.
+ * @param lock If not nullptr and its deadline is set, wait for lock after a PLL reset.
+ * @param update Receives what was written.
+ * @return 0 on success, -1 on failure or lock timeout.
+ */
+int si5351UpdateRegisters(Si5351Transport *transport, Si5351RegisterMap *current, const Si5351RegisterMap &target,
+                          Si5351Lock *lock, Si5351Update *update);
+
+/**
+ * What si5351WarmStart() found and wrote.
+ */
+struct Si5351WarmStart {
+    int registers;              // read back and compared
+    int readTransfers;
+    uint8_t status;             // register 0 as read
+    int mismatched;             // registers that held something else
+    bool unlocked;              // SYS_INIT or LOL of a PLL in use was set
+    bool untouched;             // nothing had to be written
+    Si5351Update update;        // the delta, if one was written
+};
+
+/**
+ * Bring a chip that may already be configured to a register map without
+ * disturbing it if it is: read back register 0 and every register the
+ * map defines (runs up to SI5351_UPDATE_MERGE_GAP apart share one read)
+ * and compare. If they match and the PLLs in use are locked, nothing is
+ * written and the outputs keep running. Otherwise only the registers
+ * that differ are written with si5351UpdateRegisters(); if the PLLs are
+ * not locked, their registers are rewritten so that they are reset.
+ *
+ * @param transport The bus to the chip.
+ * @param target The register map to program.
+ * @param lock If not nullptr and its deadline is set, wait for lock after a PLL reset.
+ * @param result Receives what was read and written.
+ * @return 0 on success, -1 on failure or lock timeout.
+ */
+int si5351WarmStart(Si5351Transport *transport, const Si5351RegisterMap &target, Si5351Lock *lock, Si5351WarmStart *result);
+
+#endif // SI5351_CONFIGURATION_H
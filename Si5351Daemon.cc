@@ -0,0 +1,316 @@
+/*
+ * SI5351 resident daemon
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <algorithm>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Si5351Configuration.h"
+#include "Si5351Daemon.h"
+#include "Si5351Presets.h"
+#include "Si5351Shadow.h"
+
+#define LATENCY_SAMPLES 1024
+
+/**
+ * The most recent handling times of one command, in microseconds.
+ */
+struct LatencyHistory {
+    const char *command;
+    uint32_t count;
+    float samples[LATENCY_SAMPLES];
+};
+
+struct DaemonState {
+    Si5351Transport *transport;
+    char clock0[32];            // what CLK0 was last set to
+    uint8_t outputEnable;       // register 3
+    Si5351Shadow shadow;        // what the chip holds, so a command writes only what it changes
+    bool running;
+    LatencyHistory latency[7];
+};
+
+struct Client {
+    int fd;
+    int length;
+    char line[SI5351_DAEMON_MAX_LINE];
+};
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+    stopRequested = 1;
+}
+
+static void recordLatency(DaemonState *state, const char *command, float microseconds) {
+    for (LatencyHistory &history : state->latency) {
+        if (strcmp(history.command, command) == 0) {
+            history.samples[history.count % LATENCY_SAMPLES] = microseconds;
+            history.count++;
+            return;
+        }
+    }
+}
+
+static void formatStats(const DaemonState *state, char *reply, size_t size) {
+    float sorted[LATENCY_SAMPLES];
+    int used = snprintf(reply, size, "OK");
+
+    for (const LatencyHistory &history : state->latency) {
+        uint32_t n = history.count < LATENCY_SAMPLES ? history.count : LATENCY_SAMPLES;
+        if (n == 0) {
+            continue;
+        }
+        std::copy(history.samples, history.samples + n, sorted);
+        std::sort(sorted, sorted + n);
+        used += snprintf(reply + used, size - used, " %s n=%u p50=%.1f p90=%.1f p99=%.1f max=%.1f;",
+                         history.command, history.count, sorted[n * 50 / 100], sorted[n * 90 / 100],
+                         sorted[n * 99 / 100], sorted[n - 1]);
+        if ((size_t)used >= size) {
+            break;
+        }
+    }
+}
+
+/**
+ * Stage a CLK0 image with the current output enable and commit it.
+ *
+ * @return 0 on success, -1 on failure or lock timeout.
+ */
+static int setClock0(DaemonState *state, const Si5351RegisterImage &image, Si5351Lock *lock) {
+    static Si5351RegisterMap map;
+    Si5351Update update;
+
+    si5351MapClock0(image, state->outputEnable, &map);
+    si5351ShadowStage(&state->shadow, map);
+    if (si5351ShadowCommit(state->transport, &state->shadow, lock, &update) == -1) {
+        si5351ShadowDiscard(&state->shadow);
+        return -1;
+    }
+    return 0;
+}
+
+static void formatFailure(const Si5351Lock &lock, char *reply, size_t size) {
+    if (lock.timedOut) {
+        snprintf(reply, size, "ERR no PLL lock after %u us status 0x%02x", lock.lockUs, lock.status);
+    } else {
+        snprintf(reply, size, "ERR register write failed");
+    }
+}
+
+/**
+ * Execute one command line and format its reply (without the newline).
+ */
+static void execute(DaemonState *state, char *line, char *reply, size_t size) {
+    char *command = strtok(line, " \t\r");
+    char *argument = strtok(nullptr, " \t\r");
+    Si5351Lock lock = {};
+    lock.deadlineUs = SI5351_LOCK_DEADLINE_US;
+
+    if (command == nullptr) {
+        snprintf(reply, size, "ERR empty command");
+        return;
+    }
+
+    if (strcmp(command, "preset") == 0 && argument != nullptr) {
+        const Si5351Preset *preset = si5351FindPreset(argument);
+        if (preset == nullptr) {
+            snprintf(reply, size, "ERR unknown preset %s", argument);
+        } else if (setClock0(state, preset->image, &lock) == -1) {
+            formatFailure(lock, reply, size);
+        } else {
+            snprintf(state->clock0, sizeof(state->clock0), "%s MHz", preset->name);
+            snprintf(reply, size, "OK clk0 %s lock %u us", state->clock0, lock.lockUs);
+        }
+    } else if (strcmp(command, "frequency") == 0 && argument != nullptr) {
+        uint64_t outputMilliHz;
+        Si5351Solution solution;
+        if (si5351ParseMilliHz(argument, &outputMilliHz) == -1 ||
+            si5351SolveFrequency(outputMilliHz, SI5351_XTAL_FREQUENCY, 0, &solution) == -1) {
+            snprintf(reply, size, "ERR frequency out of range");
+        } else if (setClock0(state, solution.image, &lock) == -1) {
+            formatFailure(lock, reply, size);
+        } else {
+            snprintf(state->clock0, sizeof(state->clock0), "%s Hz", argument);
+            snprintf(reply, size, "OK clk0 %s error %.6f ppb lock %u us", state->clock0, solution.errorPpb, lock.lockUs);
+        }
+    } else if ((strcmp(command, "enable") == 0 || strcmp(command, "disable") == 0) && argument != nullptr) {
+        char *end;
+        long output = strtol(argument, &end, 10);
+        uint8_t previous = state->outputEnable;
+        Si5351Update update;
+        if (end == argument || *end != '\0' || output < 0 || output > 7) {
+            snprintf(reply, size, "ERR output must be 0..7");
+            return;
+        }
+        if (command[0] == 'e') {
+            state->outputEnable &= ~(1 << output);
+        } else {
+            state->outputEnable |= 1 << output;
+        }
+        si5351ShadowSet(&state->shadow, SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, state->outputEnable);
+        if (si5351ShadowCommit(state->transport, &state->shadow, nullptr, &update) == -1) {
+            si5351ShadowDiscard(&state->shadow);
+            state->outputEnable = previous;
+            snprintf(reply, size, "ERR register write failed");
+        } else {
+            snprintf(reply, size, "OK outputs 0x%02x", state->outputEnable);
+        }
+    } else if (strcmp(command, "status") == 0) {
+        uint8_t deviceStatus;
+        if (state->transport->readBlock(SI5351_REGISTER_0_DEVICE_STATUS, &deviceStatus, 1) == -1) {
+            snprintf(reply, size, "ERR register read failed");
+        } else {
+            snprintf(reply, size, "OK clk0 %s outputs 0x%02x device 0x%02x", state->clock0, state->outputEnable, deviceStatus);
+        }
+    } else if (strcmp(command, "stats") == 0) {
+        formatStats(state, reply, size);
+    } else if (strcmp(command, "shutdown") == 0) {
+        state->running = false;
+        snprintf(reply, size, "OK shutdown");
+    } else {
+        snprintf(reply, size, "ERR unknown command %s", command);
+    }
+}
+
+/**
+ * Handle every complete line received from a client.
+ *
+ * @return 0 to keep the connection, -1 to close it.
+ */
+static int serve(DaemonState *state, Client *client) {
+    ssize_t received = read(client->fd, client->line + client->length, sizeof(client->line) - 1 - client->length);
+    if (received <= 0) {
+        return -1;
+    }
+    client->length += received;
+
+    char *newline;
+    while ((newline = (char *)memchr(client->line, '\n', client->length)) != nullptr) {
+        char reply[512];
+        struct timespec start, end;
+        char command[16] = "";
+
+        *newline = '\0';
+        sscanf(client->line, "%15s", command);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        execute(state, client->line, reply, sizeof(reply) - 1);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        recordLatency(state, command, (end.tv_sec - start.tv_sec) * 1e6f + (end.tv_nsec - start.tv_nsec) / 1e3f);
+
+        size_t length = strlen(reply);
+        reply[length++] = '\n';
+        if (write(client->fd, reply, length) != (ssize_t)length) {
+            return -1;
+        }
+
+        int consumed = newline - client->line + 1;
+        memmove(client->line, client->line + consumed, client->length - consumed);
+        client->length -= consumed;
+    }
+
+    // A line longer than the buffer is a protocol error
+    return client->length == (int)sizeof(client->line) - 1 ? -1 : 0;
+}
+
+int si5351RunDaemon(Si5351Transport *transport, const char *socketPath) {
+    static DaemonState state;
+    static const char *commands[] = { "preset", "frequency", "enable", "disable", "status", "stats", "shutdown" };
+
+    state.transport = transport;
+    state.running = true;
+    snprintf(state.clock0, sizeof(state.clock0), "unset");
+    for (int i = 0; i < 7; i++) {
+        state.latency[i].command = commands[i];
+        state.latency[i].count = 0;
+    }
+    si5351ShadowReset(&state.shadow);
+    if (transport->readBlock(SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, &state.outputEnable, 1) == -1) {
+        state.outputEnable = 0x00;
+    } else {
+        si5351ShadowKnown(&state.shadow, SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, state.outputEnable);
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", socketPath);
+        return -1;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("Failed to create the control socket");
+        return -1;
+    }
+    unlink(socketPath);
+    if (bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(listener, SI5351_DAEMON_MAX_CLIENTS) < 0) {
+        perror("Failed to listen on the control socket");
+        close(listener);
+        return -1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+
+    Client clients[SI5351_DAEMON_MAX_CLIENTS];
+    int clientCount = 0;
+
+    while (state.running && !stopRequested) {
+        struct pollfd fds[SI5351_DAEMON_MAX_CLIENTS + 1];
+        fds[0].fd = listener;
+        fds[0].events = clientCount < SI5351_DAEMON_MAX_CLIENTS ? POLLIN : 0;
+        for (int i = 0; i < clientCount; i++) {
+            fds[i + 1].fd = clients[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+
+        if (poll(fds, clientCount + 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+
+        // Serve existing clients first; closing one shifts the array down
+        for (int i = clientCount - 1; i >= 0 && state.running; i--) {
+            if (fds[i + 1].revents != 0 && serve(&state, &clients[i]) == -1) {
+                close(clients[i].fd);
+                clients[i] = clients[--clientCount];
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0) {
+                clients[clientCount].fd = fd;
+                clients[clientCount].length = 0;
+                clientCount++;
+            }
+        }
+    }
+
+    for (int i = 0; i < clientCount; i++) {
+        close(clients[i].fd);
+    }
+    close(listener);
+    unlink(socketPath);
+    return 0;
+}
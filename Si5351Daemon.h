@@ -0,0 +1,39 @@
+/*
+ * SI5351 resident daemon
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Keeps the bus open and retunes CLK0 on request. Clients connect to a
+ *   Unix domain socket and send one command per line; every command gets
+ *   exactly one reply line starting with "OK" or "ERR".
+ *
+ *     preset <name>        program a preset, e.g. "preset 3.579545"
+ *     frequency <Hz>       program any frequency, e.g. "frequency 1995000.5"
+ *     enable <n>           enable output CLKn
+ *     disable <n>          disable output CLKn
+ *     status               current frequency, output enable and device status
+ *     stats                per-command latency percentiles in microseconds
+ *     shutdown             stop the daemon
+ */
+
+#ifndef SI5351_DAEMON_H
+#define SI5351_DAEMON_H
+
+#include "Si5351Transport.h"
+
+#define SI5351_DAEMON_SOCKET "/tmp/si5351.sock"
+#define SI5351_DAEMON_MAX_CLIENTS 8
+#define SI5351_DAEMON_MAX_LINE 128
+
+/**
+ * Serve control commands until "shutdown", SIGINT or SIGTERM.
+ *
+ * @param transport The bus to the chip, kept open for the daemon's lifetime.
+ * @param socketPath Path of the Unix domain socket to listen on.
+ * @return 0 on clean shutdown, -1 if the socket could not be set up.
+ */
+int si5351RunDaemon(Si5351Transport *transport, const char *socketPath);
+
+#endif // SI5351_DAEMON_H
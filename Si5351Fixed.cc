@@ -0,0 +1,144 @@
+/*
+ * SI5351 fixed-preset configurator
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   The original single-frequency program: one preset, chosen when
+ *   building (cmake -DSI5351_FIXED_PRESET=3.579545), and no command line.
+ *   The preset table and the solver are only used by the compiler; the
+ *   binary holds the four I2C messages of the preset and is no larger
+ *   than the hand-pasted version it replaces.
+ *
+ *   The registers go out in one I2C_RDWR transfer as in
+ *   si5351ConfigureClock0(), then the program waits for PLL A to lock and
+ *   enables CLK0.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "Si5351Configuration.h"
+#include "Si5351Presets.h"
+#include "Si5351Transport.h"
+
+#ifndef SI5351_FIXED_PRESET
+#define SI5351_FIXED_PRESET "1.773447"
+#endif
+
+constexpr bool sameName(const char *a, const char *b) {
+    while (*a != '\0' && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+constexpr int fixedPresetIndex(const char *name) {
+    for (unsigned i = 0; i < SI5351_PRESET_COUNT; i++) {
+        if (sameName(SI5351_PRESETS[i].name, name)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static_assert(fixedPresetIndex(SI5351_FIXED_PRESET) >= 0, "SI5351_FIXED_PRESET is not a preset name");
+
+constexpr const Si5351Preset &FIXED_PRESET = SI5351_PRESETS[fixedPresetIndex(SI5351_FIXED_PRESET)];
+
+/**
+ * The message payloads, register address first.
+ */
+struct FixedMessages {
+    uint8_t disableOutputs[2];
+    uint8_t clockControlAndPll[19];     // registers 16-33
+    uint8_t multiSynth[9];              // registers 42-49
+    uint8_t pllReset[2];
+    uint8_t enableOutputs[2];
+};
+
+constexpr FixedMessages fixedMessages(const Si5351RegisterImage &image) {
+    FixedMessages messages = {};
+    messages.disableOutputs[0] = SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL;
+    messages.disableOutputs[1] = 0xFF;
+
+    // Powerup only output #0 (CLK0..CLK7 control, CLK3..0 and CLK7..4 disable state)
+    messages.clockControlAndPll[0] = SI5351_REGISTER_16_CLK0_CONTROL;
+    messages.clockControlAndPll[1] = image.clockControl;
+    for (int i = 2; i <= 8; i++) {
+        messages.clockControlAndPll[i] = 0x80;
+    }
+    for (int i = 0; i < 8; i++) {
+        messages.clockControlAndPll[11 + i] = image.pll[i];
+    }
+
+    messages.multiSynth[0] = SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1;
+    for (int i = 0; i < 8; i++) {
+        messages.multiSynth[1 + i] = image.multiSynth[i];
+    }
+
+    // Apply PLLA and PLLB soft reset
+    messages.pllReset[0] = SI5351_REGISTER_177_PLL_RESET;
+    messages.pllReset[1] = 0xAC;
+
+    messages.enableOutputs[0] = SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL;
+    messages.enableOutputs[1] = 0x00;
+    return messages;
+}
+
+// Not const: struct i2c_msg takes a writable buffer
+static FixedMessages MESSAGES = fixedMessages(FIXED_PRESET.image);
+
+/**
+ * Poll the device status until PLL A has locked.
+ *
+ * @return 0 once locked, -1 on a bus error or after SI5351_LOCK_DEADLINE_US.
+ */
+static int waitForLock(int fd) {
+    uint8_t reg = SI5351_REGISTER_0_DEVICE_STATUS;
+    uint8_t status;
+    struct i2c_msg read[2] = {
+        { SI5351_ADDRESS, 0, 1, &reg },
+        { SI5351_ADDRESS, I2C_M_RD, 1, &status },
+    };
+
+    for (int waited = 0; waited <= SI5351_LOCK_DEADLINE_US; waited += SI5351_LOCK_POLL_MAX_US) {
+        if (wiringPiI2CTransfer(fd, read, 2) == -1) {
+            return -1;
+        }
+        if ((status & (SI5351_STATUS_SYS_INIT | SI5351_STATUS_LOL_A)) == 0) {
+            return 0;
+        }
+        usleep(SI5351_LOCK_POLL_MAX_US);
+    }
+    fputs("PLL not locked, outputs left disabled.\n", stderr);
+    return -1;
+}
+
+int main() {
+    struct i2c_msg configuration[4] = {
+        { SI5351_ADDRESS, 0, sizeof(MESSAGES.disableOutputs), MESSAGES.disableOutputs },
+        { SI5351_ADDRESS, 0, sizeof(MESSAGES.clockControlAndPll), MESSAGES.clockControlAndPll },
+        { SI5351_ADDRESS, 0, sizeof(MESSAGES.multiSynth), MESSAGES.multiSynth },
+        { SI5351_ADDRESS, 0, sizeof(MESSAGES.pllReset), MESSAGES.pllReset },
+    };
+    struct i2c_msg enable = { SI5351_ADDRESS, 0, sizeof(MESSAGES.enableOutputs), MESSAGES.enableOutputs };
+
+    // I2C bus initialization
+    int fd = wiringPiI2CSetup(SI5351_ADDRESS);
+    if (fd == -1) {
+        fputs("I2C initialization error.\n", stderr);
+        return 1;
+    }
+
+    if (wiringPiI2CTransfer(fd, configuration, 4) == -1 || waitForLock(fd) == -1 || wiringPiI2CTransfer(fd, &enable, 1) == -1) {
+        close(fd);
+        return 1;
+    }
+    close(fd);
+
+    puts("CLK0 set to " SI5351_FIXED_PRESET " MHz.");
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * SI5351 fleet programming
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <time.h>
+
+#include "Si5351Configuration.h"
+#include "Si5351Fleet.h"
+#include "Si5351Presets.h"
+#include "Si5351Simulator.h"
+
+/**
+ * Parse one manifest line.
+ *
+ * @return 1 for a device, 0 for a blank or comment line, -1 on error.
+ */
+static int parseLine(char *line, Si5351FleetDevice *device) {
+    char *comment = strchr(line, '#');
+    if (comment != nullptr) {
+        *comment = '\0';
+    }
+
+    char *bus = strtok(line, " \t\r\n");
+    char *address = strtok(nullptr, " \t\r\n");
+    char *target = strtok(nullptr, " \t\r\n");
+    if (bus == nullptr) {
+        return 0;
+    }
+    if (address == nullptr || target == nullptr || strtok(nullptr, " \t\r\n") != nullptr) {
+        return -1;
+    }
+
+    memset(device, 0, sizeof(*device));
+    if (strspn(bus, "0123456789") == strlen(bus)) {
+        snprintf(device->bus, sizeof(device->bus), "/dev/i2c-%s", bus);
+    } else if (strlen(bus) < sizeof(device->bus)) {
+        strcpy(device->bus, bus);
+    } else {
+        return -1;
+    }
+
+    char *end;
+    device->address = (int)strtol(address, &end, 0);
+    if (*end != '\0' || device->address < 0x08 || device->address > 0x77 || strlen(target) >= sizeof(device->target)) {
+        return -1;
+    }
+    strcpy(device->target, target);
+
+    const Si5351Preset *preset = si5351FindPreset(target);
+    if (preset != nullptr) {
+        device->image = preset->image;
+        return 1;
+    }
+    uint64_t outputMilliHz;
+    Si5351Solution solution;
+    if (si5351ParseMilliHz(target, &outputMilliHz) == -1 ||
+        si5351SolveFrequency(outputMilliHz, SI5351_XTAL_FREQUENCY, 0, &solution) == -1) {
+        return -1;
+    }
+    device->image = solution.image;
+    return 1;
+}
+
+int si5351LoadFleet(const char *path, Si5351Fleet *fleet) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        perror("Failed to open the manifest");
+        return -1;
+    }
+
+    char line[256];
+    int lineNumber = 0;
+    int result = 0;
+    fleet->count = 0;
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        lineNumber++;
+        Si5351FleetDevice device;
+        int parsed = parseLine(line, &device);
+        if (parsed == 0) {
+            continue;
+        }
+        if (parsed == -1 || fleet->count == SI5351_FLEET_MAX_DEVICES) {
+            fprintf(stderr, "%s:%d: %s\n", path, lineNumber, parsed == -1 ? "expected <bus> <address> <preset or Hz>" : "too many devices");
+            result = -1;
+            break;
+        }
+        fleet->devices[fleet->count++] = device;
+    }
+
+    fclose(file);
+    return result;
+}
+
+static void programDevice(Si5351FleetDevice *device, const Si5351FleetOptions &options) {
+    uint64_t start = monotonicNs();
+    Si5351Lock lock = {};
+    lock.deadlineUs = options.lockDeadlineUs;
+
+    Si5351I2cTransport i2c;
+    Si5351Simulator simulator(options.busHz, device->address);
+    Si5351Transport *transport = &simulator;
+    if (!options.simulate) {
+        if (i2c.open(device->bus, device->address) == -1) {
+            snprintf(device->error, sizeof(device->error), "cannot open %s", device->bus);
+            device->latencyUs = (uint32_t)((monotonicNs() - start) / 1000);
+            return;
+        }
+        transport = &i2c;
+    }
+
+    if (si5351ConfigureClock0(transport, device->image, 0x00, &lock) == -1) {
+        if (lock.timedOut) {
+            snprintf(device->error, sizeof(device->error), "no PLL lock, status %02Xh", lock.status);
+        } else {
+            snprintf(device->error, sizeof(device->error), "register write failed");
+        }
+    } else {
+        device->ok = true;
+        device->lockUs = lock.lockUs;
+    }
+    device->latencyUs = (uint32_t)((monotonicNs() - start) / 1000);
+}
+
+/**
+ * Program, in manifest order, every device on one bus.
+ */
+static void programBus(Si5351Fleet *fleet, const char *bus, const Si5351FleetOptions *options) {
+    for (int i = 0; i < fleet->count; i++) {
+        if (strcmp(fleet->devices[i].bus, bus) == 0) {
+            programDevice(&fleet->devices[i], *options);
+        }
+    }
+}
+
+int si5351ProgramFleet(Si5351Fleet *fleet, const Si5351FleetOptions &options) {
+    const char *buses[SI5351_FLEET_MAX_BUSES];
+    std::thread workers[SI5351_FLEET_MAX_BUSES];
+    uint64_t start = monotonicNs();
+
+    fleet->busCount = 0;
+    for (int i = 0; i < fleet->count; i++) {
+        Si5351FleetDevice &device = fleet->devices[i];
+        device.ok = false;
+        device.error[0] = '\0';
+        device.latencyUs = 0;
+        device.lockUs = 0;
+
+        bool known = false;
+        for (int j = 0; j < fleet->busCount && !known; j++) {
+            known = strcmp(buses[j], device.bus) == 0;
+        }
+        if (!known) {
+            if (fleet->busCount == SI5351_FLEET_MAX_BUSES) {
+                snprintf(device.error, sizeof(device.error), "too many buses");
+                continue;
+            }
+            buses[fleet->busCount++] = device.bus;
+        }
+    }
+
+    for (int i = 1; i < fleet->busCount; i++) {
+        workers[i] = std::thread(programBus, fleet, buses[i], &options);
+    }
+    if (fleet->busCount > 0) {
+        programBus(fleet, buses[0], &options);
+    }
+    for (int i = 1; i < fleet->busCount; i++) {
+        workers[i].join();
+    }
+    fleet->elapsedNs = monotonicNs() - start;
+
+    int failures = 0;
+    for (int i = 0; i < fleet->count; i++) {
+        if (!fleet->devices[i].ok) {
+            failures++;
+        }
+    }
+    return failures;
+}
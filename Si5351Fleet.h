@@ -0,0 +1,74 @@
+/*
+ * SI5351 fleet programming
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Programs many boards from a manifest with one line per device:
+ *
+ *     # bus          address  preset or frequency in Hz
+ *     /dev/i2c-1     0x60     3.579545
+ *     1              0x61     1995000.5
+ *
+ *   A bus may be given as a device node or as its number. Each bus gets
+ *   its own worker thread, which programs the devices on that bus one
+ *   after the other in manifest order, so transfers on one bus never
+ *   interleave while all buses run at the same time.
+ */
+
+#ifndef SI5351_FLEET_H
+#define SI5351_FLEET_H
+
+#include <stdint.h>
+
+#include "Si5351Solver.h"
+
+#define SI5351_FLEET_MAX_DEVICES 64
+#define SI5351_FLEET_MAX_BUSES 16
+
+struct Si5351FleetDevice {
+    char bus[32];               // device node
+    int address;
+    char target[32];            // as written in the manifest
+    Si5351RegisterImage image;
+
+    // Result
+    bool ok;
+    char error[64];
+    uint32_t latencyUs;         // open, program and wait for lock
+    uint32_t lockUs;
+};
+
+struct Si5351Fleet {
+    int count;
+    Si5351FleetDevice devices[SI5351_FLEET_MAX_DEVICES];
+    int busCount;
+    uint64_t elapsedNs;         // whole fleet
+};
+
+struct Si5351FleetOptions {
+    bool simulate;              // one Si5351Simulator per device instead of i2c-dev
+    uint32_t busHz;             // simulated bus clock
+    uint32_t lockDeadlineUs;    // 0 = do not wait for lock
+};
+
+/**
+ * Read a manifest and solve every target.
+ *
+ * @param path The manifest file.
+ * @param fleet Receives the devices.
+ * @return 0 on success, -1 on a malformed manifest (reported on stderr).
+ */
+int si5351LoadFleet(const char *path, Si5351Fleet *fleet);
+
+/**
+ * Program every device, one worker thread per bus.
+ *
+ * @param fleet The devices; their results are filled in.
+ * @param options Transport and lock options.
+ * @return Number of devices that failed.
+ */
+int si5351ProgramFleet(Si5351Fleet *fleet, const Si5351FleetOptions &options);
+
+#endif // SI5351_FLEET_H
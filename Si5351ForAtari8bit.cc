@@ -22,614 +22,1202 @@
  *   - 14.31818 MHz (Atari XL/XE NTSC)
  *
  * Change History:
+ *   Version 1.27 - single-preset build chosen at compile time, no larger than version 1.3 (Si5351Fixed)
+ *   Version 1.26 - multi-threaded crystal tolerance and drift analysis of the presets, CSV or JSON (--analyze)
+ *   Version 1.25 - per-board crystal calibration with a cache of re-solved presets (--calibration)
+ *   Version 1.24 - shadow register file with dirty tracking; the daemon writes only the registers a command changes
+ *   Version 1.23 - warm start that leaves a chip already running the configuration alone (--warm)
+ *   Version 1.22 - dual-PLL ping-pong switching of CLK0 without a PLL reset (--ping-pong)
+ *   Version 1.21 - ring-buffer trace of every bus transfer, with Chrome JSON export and replay (--trace, si5351_trace)
+ *   Version 1.20 - health monitor for loss of lock, loss of the crystal and restarts (--monitor, --reapply)
+ *   Version 1.19 - memory-mapped index of solved frequencies with binary search (--build-index, --index)
+ *   Version 1.18 - static early-boot build without iostreams (Si5351Boot)
+ *   Version 1.17 - glitch-free fine trim through PLL A P2 only (--trim, --trim-report)
+ *   Version 1.16 - timed frequency sequence player with switch jitter statistics (--sequence, --realtime)
+ *   Version 1.15 - hot reload of a clock config file with minimal register updates (--watch)
+ *   Version 1.14 - ClockBuilder Pro register map importer and binary preset store (--import, --store)
+ *   Version 1.13 - block read-back verification and repair of the register image (--verify, --repair)
+ *   Version 1.12 - parallel fleet programming from a manifest, one worker per bus (--fleet)
+ *   Version 1.11 - multi-threaded low-jitter divider search with a Pareto front (--search)
+ *   Version 1.10 - wait for PLL lock before enabling outputs and report the time (--lock-deadline)
+ *   Version 1.9 - bus statistics per programming phase (--stats, --stats=json)
+ *   Version 1.8 - pluggable transport and software Si5351 simulator (--simulate, --bus-speed)
+ *   Version 1.7 - multi-output dual-PLL frequency planner (--plan)
+ *   Version 1.6 - resident daemon with a Unix socket control API (--daemon)
+ *   Version 1.5 - runtime solver for arbitrary frequencies (--frequency, --check)
+ *   Version 1.4 - presets solved at compile time and selected on the command line
+ *   Version 1.3 - register runs sent as block writes in one I2C_RDWR transfer
  *   Version 1.2 - added size optimization flags to CMakeLists.txt
  *   Version 1.1 - replaced WiringPi library with functions from linux/i2c-dev.h
  *   Version 1.0 - Initial release
  *
  */
 
-#include <fcntl.h>
 #include <iostream>
-#include <linux/i2c-dev.h>
+#include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
-#include <sys/ioctl.h>
-#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "Si5351Calibration.h"
+#include "Si5351Configuration.h"
+#include "Si5351Daemon.h"
+#include "Si5351Fleet.h"
+#include "Si5351FrequencyIndex.h"
+#include "Si5351Monitor.h"
+#include "Si5351PingPong.h"
+#include "Si5351PresetStore.h"
+#include "Si5351Presets.h"
+#include "Si5351Search.h"
+#include "Si5351Sequence.h"
+#include "Si5351Simulator.h"
+#include "Si5351Tolerance.h"
+#include "Si5351Trace.h"
+#include "Si5351Transport.h"
+#include "Si5351Trim.h"
+#include "Si5351Verify.h"
+#include "Si5351Watch.h"
+
+void printPresets() {
+    for (const Si5351Preset &preset : SI5351_PRESETS) {
+        std::cout << "  " << preset.name << " MHz (" << preset.description << ")" << std::endl;
+    }
+}
+
+double elapsedMicroseconds(const struct timespec &start, const struct timespec &end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
 
-#define SI5351_ADDRESS 0x60
+void printSolution(const Si5351Solution &solution) {
+    std::cout << "  Feedback Divider = " << solution.feedback.a << "  " << solution.feedback.b << "/" << solution.feedback.c << std::endl;
+    std::cout << "  Multisynth Divider = " << solution.multiSynth << std::endl;
+    std::cout << "  R Divider = " << (1 << solution.rDividerLog2) << std::endl;
+    std::cout << "  Error (ppb) = " << solution.errorPpb << std::endl;
+}
 
-#define SI5351_REGISTER_0_DEVICE_STATUS 0
-#define SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL 3
+/**
+ * Check the runtime solver against the ClockBuilder Pro export: with the
+ * preset's MultiSynth divider the PLL and MultiSynth registers must match
+ * the exported bytes, or be at least as accurate where ClockBuilder had
+ * rounded the VCO (reported as DIFF with both errors). The result must also
+ * match the compile-time preset table, and the free search must be at least
+ * as accurate.
+ *
+ * @return Number of presets that failed.
+ */
+int checkSolver() {
+    int failures = 0;
+    int differences = 0;
+
+    for (unsigned p = 0; p < SI5351_PRESET_COUNT; p++) {
+        const Si5351Preset &preset = SI5351_PRESETS[p];
+        const uint8_t *clockBuilder = SI5351_CLOCKBUILDER_IMAGES[p];
+        Si5351Solution pinned;
+        Si5351Solution searched;
+        struct timespec start, end;
+        const int iterations = 100;
+
+        bool solved = si5351SolveFrequency(preset.outputMilliHz, SI5351_XTAL_FREQUENCY, preset.multiSynth, &pinned) == 0;
+        bool matches = solved && memcmp(&pinned.image, &preset.image, sizeof(preset.image)) == 0;
+        bool identical = solved && memcmp(pinned.image.pll, clockBuilder, 8) == 0 &&
+                         memcmp(pinned.image.multiSynth, clockBuilder + 8, 8) == 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < iterations; i++) {
+            if (si5351SolveFrequency(preset.outputMilliHz, SI5351_XTAL_FREQUENCY, 0, &searched) == -1) {
+                matches = false;
+                break;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double pinnedError = solved ? si5351ErrorPpb(pinned.image.pll, pinned.image.multiSynth, preset.outputMilliHz) : 0;
+        double clockBuilderError = si5351ErrorPpb(clockBuilder, clockBuilder + 8, preset.outputMilliHz);
+        if (!identical && pinnedError > clockBuilderError + 1e-3) {
+            matches = false;
+        }
+        double searchedError = searched.errorPpb < 0 ? -searched.errorPpb : searched.errorPpb;
+        if (searchedError > pinnedError + 1e-3) {
+            matches = false;
+        }
+
+        std::cout << (!matches ? "FAIL " : identical ? "OK   " : "DIFF ") << preset.name << " MHz: ";
+        if (!identical) {
+            std::cout << "differs from ClockBuilder Pro, " << pinnedError << " ppb against " << clockBuilderError << " ppb; ";
+        }
+        std::cout << "search picked MultiSynth " << searched.multiSynth << ", " << searched.errorPpb << " ppb, "
+                  << elapsedMicroseconds(start, end) / iterations << " us" << std::endl;
+        if (!matches) {
+            failures++;
+        } else if (!identical) {
+            differences++;
+        }
+    }
+
+    std::cout << SI5351_PRESET_COUNT - failures - differences << " presets identical to ClockBuilder Pro, " << differences
+              << " more accurate, " << failures << " failed" << std::endl;
+    return failures;
+}
+
+/**
+ * Parse a comma-separated list of frequencies in hertz.
+ *
+ * @return Number of frequencies, or -1 on a malformed list.
+ */
+int parseFrequencyList(const char *text, uint64_t *outputMilliHz, int capacity) {
+    char buffer[256];
+    int count = 0;
+
+    strncpy(buffer, text, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+    for (char *item = strtok(buffer, ","); item != nullptr; item = strtok(nullptr, ",")) {
+        if (count == capacity || si5351ParseMilliHz(item, &outputMilliHz[count]) == -1) {
+            return -1;
+        }
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Run the low-jitter search for every frequency of a list and print the
+ * Pareto front of each.
+ *
+ * @return 0 on success, 1 if a frequency has no solution.
+ */
+int searchDividers(const uint64_t *outputMilliHz, int count, const Si5351SearchOptions &options) {
+    static Si5351SearchResult result;
+    char line[160];
+
+    for (int i = 0; i < count; i++) {
+        snprintf(line, sizeof(line), "%.9f", outputMilliHz[i] / 1e9);
+        std::cout << "Output Frequency (MHz) = " << line << std::endl;
+        if (si5351Search(outputMilliHz[i], SI5351_XTAL_FREQUENCY, options, &result) == -1) {
+            std::cerr << "Frequency out of range." << std::endl;
+            return 1;
+        }
+
+        std::cout << "  Penalty  Error (ppb)  VCO (MHz)       Feedback Divider         Multisynth Divider      R" << std::endl;
+        for (int j = 0; j < result.frontCount; j++) {
+            const Si5351Candidate &candidate = result.front[j];
+            snprintf(line, sizeof(line), "%c %7.1f %12.6f  %-14.6f  %2u %7u/%-7u         %4u %7u/%-7u  %3u",
+                     j == result.best ? '*' : ' ', candidate.penalty, candidate.errorPpb, candidate.vcoMilliHz / 1e9,
+                     candidate.feedback.a, candidate.feedback.b, candidate.feedback.c,
+                     candidate.multiSynth.a, candidate.multiSynth.b, candidate.multiSynth.c, 1u << candidate.rDividerLog2);
+            std::cout << line << std::endl;
+        }
+        snprintf(line, sizeof(line), "  %llu candidates, %d threads, %u steals, %.1f ms",
+                 (unsigned long long)result.evaluated, result.threads, result.steals, result.elapsedNs / 1e6);
+        std::cout << line << std::endl;
+    }
+    std::cout << "* lowest |error| + " << options.penaltyWeightPpb << " ppb x penalty" << std::endl;
+    return 0;
+}
 
-#define SI5351_REGISTER_16_CLK0_CONTROL 16
-#define SI5351_REGISTER_17_CLK1_CONTROL 17
-#define SI5351_REGISTER_18_CLK2_CONTROL 18
-#define SI5351_REGISTER_19_CLK3_CONTROL 19
-#define SI5351_REGISTER_20_CLK4_CONTROL 20
-#define SI5351_REGISTER_21_CLK5_CONTROL 21
-#define SI5351_REGISTER_22_CLK6_CONTROL 22
-#define SI5351_REGISTER_23_CLK7_CONTROL 23
-#define SI5351_REGISTER_24_CLK3_0_DISABLE_STATE 24
-#define SI5351_REGISTER_25_CLK7_4_DISABLE_STATE 25
+void printFleet(const Si5351Fleet &fleet) {
+    char line[160];
+    uint64_t sumUs = 0;
+    int failures = 0;
+
+    std::cout << "Bus                Address  Target           Result  Latency (us)  Lock (us)" << std::endl;
+    for (int i = 0; i < fleet.count; i++) {
+        const Si5351FleetDevice &device = fleet.devices[i];
+        snprintf(line, sizeof(line), "%-18s 0x%02x     %-16s %-6s %13u %10u%s%s", device.bus, device.address, device.target,
+                 device.ok ? "OK" : "FAIL", device.latencyUs, device.lockUs, device.ok ? "" : "  ", device.error);
+        std::cout << line << std::endl;
+        sumUs += device.latencyUs;
+        failures += !device.ok;
+    }
+    snprintf(line, sizeof(line), "%d devices on %d buses, %d failed, %.1f ms (%.1f ms one after the other)",
+             fleet.count, fleet.busCount, failures, fleet.elapsedNs / 1e6, sumUs / 1e3);
+    std::cout << line << std::endl;
+}
 
-#define SI5351_REGISTER_26_PLL_A_REG0 26
-#define SI5351_REGISTER_27_PLL_A_REG1 27
-#define SI5351_REGISTER_28_PLL_A_REG2 28
-#define SI5351_REGISTER_29_PLL_A_REG3 29
-#define SI5351_REGISTER_30_PLL_A_REG4 30
-#define SI5351_REGISTER_31_PLL_A_REG5 31
-#define SI5351_REGISTER_32_PLL_A_REG6 32
-#define SI5351_REGISTER_33_PLL_A_REG7 33
+void printJitter(const char *label, const Si5351Jitter &jitter) {
+    char line[160];
+    snprintf(line, sizeof(line), "%-8s min %8.1f  mean %8.1f  max %8.1f  stddev %7.1f  p99 %8.1f us (%d steps)",
+             label, jitter.minUs, jitter.meanUs, jitter.maxUs, jitter.stddevUs, jitter.p99Us, jitter.count);
+    std::cout << line << std::endl;
+}
 
-#define SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1 42
-#define SI5351_REGISTER_43_MULTISYNTH0_PARAMETERS_2 43
-#define SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3 44
-#define SI5351_REGISTER_45_MULTISYNTH0_PARAMETERS_4 45
-#define SI5351_REGISTER_46_MULTISYNTH0_PARAMETERS_5 46
-#define SI5351_REGISTER_47_MULTISYNTH0_PARAMETERS_6 47
-#define SI5351_REGISTER_48_MULTISYNTH0_PARAMETERS_7 48
-#define SI5351_REGISTER_49_MULTISYNTH0_PARAMETERS_8 49
+void printSequence(const Si5351Sequence &sequence) {
+    char line[160];
+    Si5351Jitter jitter;
+
+    std::cout << "Step  Scheduled (ms)  Target           Result  Wake (us)  Switch (us)  Registers  PLL reset" << std::endl;
+    for (int i = 0; i < sequence.count; i++) {
+        const Si5351Step &step = sequence.steps[i];
+        snprintf(line, sizeof(line), "%4d %15.3f  %-16s %-6s %10.1f %12.1f %10d  %s%s", i, step.offsetNs / 1e6, step.target,
+                 step.ok ? "OK" : "FAIL", step.wakeNs / 1e3, step.switchNs / 1e3, step.update.written,
+                 step.update.pllReset ? "yes" : "no", step.expirations > 1 ? "  (late)" : "");
+        std::cout << line << std::endl;
+    }
+    std::cout << "Times after the scheduled time:" << std::endl;
+    si5351SequenceJitter(sequence, false, &jitter);
+    printJitter("Wake", jitter);
+    si5351SequenceJitter(sequence, true, &jitter);
+    printJitter("Switch", jitter);
+}
 
-#define SI5351_REGISTER_177_PLL_RESET 177
+void printPlan(const Si5351Plan &plan) {
+    char mhz[32];
 
+    for (int pll = 0; pll < 2; pll++) {
+        if (plan.pllUsed & (1 << pll)) {
+            std::cout << "PLL " << (char)('A' + pll) << std::endl;
+            snprintf(mhz, sizeof(mhz), "%.9f", plan.vcoMilliHz[pll] / 1e9);
+            std::cout << "  VCO Frequency (MHz) = " << mhz << std::endl;
+            std::cout << "  Feedback Divider = " << plan.feedback[pll].a << "  " << plan.feedback[pll].b << "/" << plan.feedback[pll].c << std::endl;
+        }
+    }
+    for (int i = 0; i < plan.outputCount; i++) {
+        const Si5351PlanOutput &output = plan.outputs[i];
+        std::cout << "Channel " << i << std::endl;
+        snprintf(mhz, sizeof(mhz), "%.9f", output.outputMilliHz / 1e9);
+        std::cout << "  Output Frequency (MHz) = " << mhz << std::endl;
+        std::cout << "  PLL source = PLL" << (char)('A' + output.pll) << std::endl;
+        std::cout << "  Multisynth Divider = " << output.multiSynth.a << "  " << output.multiSynth.b << "/" << output.multiSynth.c << std::endl;
+        std::cout << "  R Divider = " << (1 << output.rDividerLog2) << std::endl;
+        std::cout << "  Error (ppb) = " << output.errorPpb << std::endl;
+    }
+    std::cout << "Worst-case error (ppb) = " << plan.worstErrorPpb << std::endl;
+
+    // Register map in ClockBuilder Pro "Address,Data" form
+    std::cout << "Address,Data" << std::endl;
+    for (int i = 0; i < SI5351_PLAN_REGISTER_COUNT; i++) {
+        char line[16];
+        snprintf(line, sizeof(line), "%d,%02Xh", SI5351_PLAN_FIRST_REGISTER + i, plan.registers[i]);
+        std::cout << line << std::endl;
+    }
+}
 
-#define I2C_DEVICE "/dev/i2c-1"
+void printLock(const Si5351Lock &lock) {
+    std::cout << "PLL locked after " << lock.lockUs << " us (" << lock.polls << " status reads)." << std::endl;
+}
 
+void printLockTimeout(const Si5351Lock &lock) {
+    char line[128];
+    snprintf(line, sizeof(line), "PLL not locked after %u us (status %02Xh), outputs left disabled.",
+             lock.lockUs, lock.status);
+    std::cerr << line << std::endl;
+}
 
+void printMismatches(const Si5351Verification &verification) {
+    char line[64];
+    for (int i = 0; i < verification.mismatchCount; i++) {
+        const Si5351Mismatch &mismatch = verification.mismatches[i];
+        snprintf(line, sizeof(line), "  Register %d: expected %02Xh, read %02Xh", mismatch.reg, mismatch.expected, mismatch.actual);
+        std::cout << line << std::endl;
+    }
+}
 
 /**
- * Initialize the I2C bus and set the target device address.
+ * Read back the intended register map and, if asked to, rewrite the
+ * registers that differ, waiting up to lockDeadlineUs for a reset PLL.
  *
- * @param deviceAddress The address of the I2C device.
- * @return File descriptor for the I2C bus, or -1 on failure.
+ * @return 0 if the chip matches the map (after repair), 1 otherwise.
  */
-int wiringPiI2CSetup(int deviceAddress) {
-    const char *device = I2C_DEVICE;
-    int file;
+int verifyRegisters(Si5351Transport *transport, const Si5351RegisterMap &map, bool repair, uint32_t lockDeadlineUs) {
+    static Si5351Verification verification;
 
-    // Open the I2C bus
-    if ((file = open(device, O_RDWR)) < 0) {
-        perror("Failed to open the I2C bus");
-        return -1;
+    int mismatches = si5351Verify(transport, map, &verification);
+    if (mismatches == -1) {
+        std::cerr << "Register read error." << std::endl;
+        return 1;
+    }
+    std::cout << "Verified " << verification.registers << " registers in " << verification.transfers << " transfer(s): "
+              << (mismatches == 0 ? "OK" : std::to_string(mismatches) + " mismatched") << std::endl;
+    printMismatches(verification);
+    if (mismatches == 0 || !repair) {
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    Si5351Lock lock = {};
+    lock.deadlineUs = lockDeadlineUs;
+    mismatches = si5351Repair(transport, map, &lock, &verification);
+    if (mismatches == -1) {
+        if (lock.timedOut) {
+            printLockTimeout(lock);
+        } else {
+            std::cerr << "Register write error." << std::endl;
+        }
+        return 1;
     }
+    std::cout << "Rewrote " << verification.repaired << " registers" << (verification.pllReset ? " and reset the PLL" : "")
+              << ", " << verification.transfers << " transfer(s): " << (mismatches == 0 ? "OK" : std::to_string(mismatches) + " still mismatched")
+              << std::endl;
+    printMismatches(verification);
+    return mismatches == 0 ? 0 : 1;
+}
+
+/**
+ * Program a register map only as far as the chip does not already hold
+ * it, reporting what was found.
+ *
+ * @return 0 on success, -1 on failure or lock timeout.
+ */
+int warmStart(Si5351Transport *transport, const Si5351RegisterMap &map, Si5351Lock *lock) {
+    Si5351WarmStart warm;
+    char line[200];
 
-    // Set the I2C slave address
-    if (ioctl(file, I2C_SLAVE, deviceAddress) < 0) {
-        perror("Failed to set I2C slave address");
-        close(file);
+    if (si5351WarmStart(transport, map, lock, &warm) == -1) {
         return -1;
     }
+    if (warm.untouched) {
+        snprintf(line, sizeof(line), "Already configured and locked: %d registers read in %d transfer(s), nothing written.",
+                 warm.registers, warm.readTransfers);
+    } else {
+        snprintf(line, sizeof(line), "Warm start: %d of %d registers differ, status %02Xh; wrote %d in %d transfer(s), %s.",
+                 warm.mismatched, warm.registers, warm.status, warm.update.written, warm.update.transfers,
+                 warm.update.pllReset ? "PLLs reset" : "outputs not disabled");
+    }
+    std::cout << line << std::endl;
+    return 0;
+}
+
+void printSimulatorTotals(const Si5351Simulator &simulator, uint32_t busHz) {
+    char line[128];
+    snprintf(line, sizeof(line), "Simulated bus at %u Hz: %u transfers, %u messages, %u bytes, %.1f us",
+             busHz, simulator.transfers, simulator.messages, simulator.bytes, simulator.busNs / 1000.0);
+    std::cout << line << std::endl;
+}
 
-    return file;
+void printMonitor(const Si5351MonitorStats &monitor, uint32_t busHz) {
+    char line[256];
+    double seconds = monitor.elapsedNs / 1e9;
+    snprintf(line, sizeof(line), "Monitored for %.1f s: %u polls, %u events (%u glitches), %u reapplied, %u bus errors; "
+             "CPU %.1f ms (%.3f%%), bus %.3f%% at %u Hz",
+             seconds, monitor.polls, monitor.events, monitor.glitches, monitor.reapplied, monitor.busErrors,
+             monitor.cpuNs / 1e6, seconds > 0 ? monitor.cpuNs / 1e7 / seconds : 0.0,
+             seconds > 0 && busHz > 0 ? monitor.wireBits * 100.0 / busHz / seconds : 0.0, busHz);
+    std::cout << line << std::endl;
 }
 
 /**
- * Write an 8-bit value to a specific register on the I2C device.
+ * Simulate a fault on SIGUSR1 (brown-out) and SIGUSR2 (crystal lost).
+ */
+void simulateFault(int signal) {
+    Si5351Simulator::injectFault(signal == SIGUSR1 ? SI5351_SIMULATOR_FAULT_BROWNOUT : SI5351_SIMULATOR_FAULT_XTAL);
+}
+
+void printStoredPresets(const Si5351Store &store) {
+    std::cout << "Stored presets:" << std::endl;
+    for (int i = 0; i < store.header->presetCount; i++) {
+        std::cout << "  " << store.entries[i].name << " (" << store.entries[i].registerCount << " registers)" << std::endl;
+    }
+}
+
+/**
+ * Compile ClockBuilder Pro exports into a preset file. Presets already in
+ * the file are kept unless an import has the same name.
  *
- * @param file File descriptor of the I2C bus (returned by wiringPiI2CSetup).
- * @param reg The register address to write to.
- * @param value The 8-bit value to write.
- * @return 0 on success, -1 on failure.
+ * @param path The preset file.
+ * @param files The exports, each "[name=]file"; the name defaults to the
+ *              file name without directory and extension.
+ * @return 0 on success, 1 on failure.
  */
-int wiringPiI2CWriteReg8(int file, uint8_t reg, uint8_t value) {
-    uint8_t buffer[2];
-    buffer[0] = reg;    // Register address
-    buffer[1] = value;  // Value to write
-
-    // Write the register address and value to the I2C device
-    if (write(file, buffer, 2) != 2) {
-        perror("Failed to write to I2C device");
-        return -1;
+int importPresets(const char *path, char *const *files, int count) {
+    static char names[SI5351_STORE_MAX_PRESETS][SI5351_STORE_NAME_LENGTH];
+    static const char *namePointers[SI5351_STORE_MAX_PRESETS];
+    static Si5351RegisterMap maps[SI5351_STORE_MAX_PRESETS];
+    int presetCount = 0;
+
+    FILE *existing = fopen(path, "r");
+    if (existing != nullptr) {
+        fclose(existing);
+        Si5351Store store;
+        if (si5351OpenStore(path, &store) == -1) {
+            return 1;
+        }
+        for (int i = 0; i < store.header->presetCount; i++) {
+            strcpy(names[presetCount], store.entries[i].name);
+            si5351MapStored(store, store.entries[i], &maps[presetCount++]);
+        }
+        si5351CloseStore(&store);
+    }
+
+    for (int i = 0; i < count; i++) {
+        const char *file = files[i];
+        const char *equals = strchr(file, '=');
+        char name[SI5351_STORE_NAME_LENGTH];
+        if (equals != nullptr) {
+            snprintf(name, sizeof(name), "%.*s", (int)(equals - file), file);
+            file = equals + 1;
+        } else {
+            const char *base = strrchr(file, '/') != nullptr ? strrchr(file, '/') + 1 : file;
+            const char *dot = strrchr(base, '.');
+            snprintf(name, sizeof(name), "%.*s", (int)(dot != nullptr ? dot - base : strlen(base)), base);
+        }
+        if (name[0] == '\0') {
+            std::cerr << "No preset name for " << files[i] << "." << std::endl;
+            return 1;
+        }
+
+        int index = 0;
+        while (index < presetCount && strcmp(names[index], name) != 0) {
+            index++;
+        }
+        if (index == SI5351_STORE_MAX_PRESETS) {
+            std::cerr << "Too many presets." << std::endl;
+            return 1;
+        }
+        if (si5351ImportCbp(file, &maps[index]) == -1) {
+            return 1;
+        }
+        bool replaced = index < presetCount;
+        if (!replaced) {
+            strcpy(names[presetCount++], name);
+        }
+        std::cout << (replaced ? "Replaced " : "Imported ") << name << " from " << file << "." << std::endl;
     }
 
+    for (int i = 0; i < presetCount; i++) {
+        namePointers[i] = names[i];
+    }
+    if (si5351WriteStore(path, namePointers, maps, presetCount) == -1) {
+        return 1;
+    }
+    std::cout << "Wrote " << presetCount << " presets to " << path << "." << std::endl;
     return 0;
 }
 
+/**
+ * Apply the ppb offsets read from standard input, one per line, to the
+ * CLK0 image the chip has just been programmed with.
+ *
+ * @return 0 if every offset was applied, 1 otherwise.
+ */
+int trimFromInput(Si5351Transport *transport, const Si5351RegisterImage &image) {
+    Si5351Trim trim;
+    char line[160];
+    int offsets = 0;
+    int result = 0;
+    struct timespec start, end;
+
+    si5351TrimInit(image, &trim);
+    snprintf(line, sizeof(line), "Trim step %.3f ppb, range %.3f to %.3f ppm; reading offsets in ppb from standard input.",
+             trim.ppbPerStep, trim.minPpb / 1000, trim.maxPpb / 1000);
+    std::cout << line << std::endl;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (fgets(line, sizeof(line), stdin) != nullptr) {
+        char *end;
+        double ppb = strtod(line, &end);
+        if (end == line) {
+            continue;
+        }
+        offsets++;
+        if (si5351Trim(transport, &trim, ppb) == -1) {
+            std::cerr << "Offset " << ppb << " ppb not applied (out of range or write error)." << std::endl;
+            result = 1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
 
+    snprintf(line, sizeof(line), "%d offsets, %u writes of %u registers in %.1f ms, offset now %.3f ppb.", offsets,
+             trim.updates, trim.registers, elapsedMicroseconds(start, end) / 1000, trim.ppb);
+    std::cout << line << std::endl;
+    return result;
+}
 
+/**
+ * Read a preset name or a frequency in Hz.
+ *
+ * @param multiSynth Receives the preset's MultiSynth divider, or 0 for a frequency.
+ * @return 0 on success, -1 if the text is neither.
+ */
+int parseClock(const char *text, uint64_t *outputMilliHz, uint32_t *multiSynth) {
+    const Si5351Preset *preset = si5351FindPreset(text);
+    *multiSynth = preset != nullptr ? preset->multiSynth : 0;
+    if (preset != nullptr) {
+        *outputMilliHz = preset->outputMilliHz;
+        return 0;
+    }
+    return si5351ParseMilliHz(text, outputMilliHz);
+}
 
+/**
+ * Put two clocks on PLL A and PLL B, then switch CLK0 to the preset or
+ * frequency on each line of standard input, reporting every switch.
+ *
+ * @return 0 if every switch succeeded, 1 otherwise.
+ */
+int pingPongFromInput(Si5351Transport *transport, const char *pair, Si5351Lock *lock, uint32_t busHz) {
+    static Si5351PingPong pingPong;
+    uint64_t outputMilliHz[2];
+    uint32_t multiSynth[2];
+    char first[64];
+    char line[200];
+    struct timespec start, end;
+
+    // On-wire times at the nominal bus speed, also when the simulator does not model it
+    double wireHz = busHz > 0 ? busHz : 100000;
+
+    const char *comma = strchr(pair, ',');
+    snprintf(first, sizeof(first), "%.*s", comma != nullptr ? (int)(comma - pair) : 0, pair);
+    if (comma == nullptr || parseClock(first, &outputMilliHz[0], &multiSynth[0]) == -1 ||
+        parseClock(comma + 1, &outputMilliHz[1], &multiSynth[1]) == -1) {
+        std::cerr << "Expected two presets or frequencies in Hz: <A>,<B>." << std::endl;
+        return 1;
+    }
+    if (si5351PingPongSolve(outputMilliHz, multiSynth, &pingPong) == -1) {
+        std::cerr << "Frequency out of range." << std::endl;
+        return 1;
+    }
+    for (int pll = 0; pll < 2; pll++) {
+        snprintf(line, sizeof(line), "PLL %c: %.6f MHz, MultiSynth %u, error %.3f ppb", 'A' + pll, pingPong.outputMilliHz[pll] / 1e9,
+                 pingPong.divider[pll], pingPong.errorPpb[pll]);
+        std::cout << line << std::endl;
+    }
 
-void writeRegister(int fd, int reg, int value) {
-    if (wiringPiI2CWriteReg8(fd, reg, value) == -1) {
-        std::cerr << "Regiter write error." << reg << std::endl;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (si5351PingPongSetup(transport, pingPong, lock) == -1) {
+        if (lock->timedOut) {
+            printLockTimeout(*lock);
+        } else {
+            std::cerr << "Register write error." << std::endl;
+        }
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    snprintf(line, sizeof(line), "Both PLLs locked, CLK0 from PLL A; setup took %.0f us with the outputs off. Reading presets or "
+             "frequencies from standard input.", elapsedMicroseconds(start, end));
+    std::cout << line << std::endl;
+
+    int switches = 0;
+    int result = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    while (fgets(line, sizeof(line), stdin) != nullptr) {
+        char *token = strtok(line, " \t\r\n");
+        uint64_t milliHz;
+        uint32_t ignored;
+        Si5351Switch done;
+        if (token == nullptr) {
+            continue;
+        }
+        if (parseClock(token, &milliHz, &ignored) == -1 ||
+            si5351PingPongSelect(transport, &pingPong, milliHz, lock->deadlineUs, &done) == -1) {
+            std::cerr << token << ": not switched (out of range, write error or no lock)." << std::endl;
+            result = 1;
+            continue;
+        }
+        if (done.registers == 0) {
+            continue;
+        }
+
+        char loaded[64] = "";
+        char transition[64] = "";
+        if (done.loaded) {
+            snprintf(loaded, sizeof(loaded), " (loaded, locked after %u us)", done.lockUs);
+        }
+        if (done.transitionBits > 0) {
+            snprintf(transition, sizeof(transition), ", intermediate frequency for %.0f us", done.transitionBits * 1e6 / wireHz);
+        }
+        snprintf(line, sizeof(line), " at %.6f MHz: %d register(s), %.0f us on the wire, %.0f us transfer, output not disabled",
+                 milliHz / 1e9, done.registers, done.wireBits * 1e6 / wireHz, done.switchNs / 1e3);
+        std::cout << "CLK0 from PLL " << (char)('A' + pingPong.active) << loaded << line << transition << std::endl;
+        switches++;
+        totalNs += done.switchNs;
+        maxNs = done.switchNs > maxNs ? done.switchNs : maxNs;
+    }
+
+    if (switches > 0) {
+        snprintf(line, sizeof(line), "%d switches, transfer %.1f us mean, %.1f us max.", switches, totalNs / 1e3 / switches, maxNs / 1e3);
+        std::cout << line << std::endl;
     }
+    return result;
 }
 
-int main() {
+/**
+ * Program every preset and sweep its trim back and forth, reporting the
+ * resolution, range and sustained update rate.
+ *
+ * @return 0 on success, 1 on a bus failure.
+ */
+int reportTrim(Si5351Transport *transport) {
+    const int updates = 500;
+    char line[160];
+
+    std::cout << "Preset (MHz)   P3        Step (ppb)  Range (ppm)          Updates/s  Registers/update" << std::endl;
+    for (const Si5351Preset &preset : SI5351_PRESETS) {
+        Si5351Trim trim;
+        struct timespec start, end;
+
+        if (si5351ConfigureClock0(transport, preset.image) == -1) {
+            std::cerr << "Register write error." << std::endl;
+            return 1;
+        }
+        si5351TrimInit(preset.image, &trim);
+
+        // Triangle sweep of +-50 steps, as a control loop would hunt around lock
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < updates; i++) {
+            int phase = i % 200;
+            int steps = phase < 100 ? phase - 50 : 150 - phase;
+            if (si5351Trim(transport, &trim, steps * trim.ppbPerStep) == -1) {
+                std::cerr << "Trim failed for " << preset.name << " MHz." << std::endl;
+                return 1;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        snprintf(line, sizeof(line), "%-14s %-9u %10.4f  %8.2f to %+7.2f %11.0f %17.2f", preset.name, trim.base.p3, trim.ppbPerStep,
+                 trim.minPpb / 1000, trim.maxPpb / 1000, trim.updates / (elapsedMicroseconds(start, end) / 1e6),
+                 trim.updates == 0 ? 0.0 : (double)trim.registers / trim.updates);
+        std::cout << line << std::endl;
+    }
+    return 0;
+}
 
-    // I2C bus initialization
-    int fd = wiringPiI2CSetup(SI5351_ADDRESS);
-    if (fd == -1) {
-        std::cerr << "I2C initialization error." << std::endl;
+/**
+ * Generate a frequency index and report its size.
+ *
+ * @return 0 on success, 1 on failure.
+ */
+int buildIndex(const char *path, const char *lowHz, const char *highHz, uint32_t resolutionPpb) {
+    uint64_t lowMilliHz, highMilliHz;
+    struct timespec start, end;
+    char line[160];
+
+    if (si5351ParseMilliHz(lowHz, &lowMilliHz) == -1 || si5351ParseMilliHz(highHz, &highMilliHz) == -1 ||
+        highMilliHz < lowMilliHz || resolutionPpb == 0) {
+        std::cerr << "Expected a band <low Hz> <high Hz> and a resolution above 0 ppb." << std::endl;
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int64_t count = si5351WriteIndex(path, lowMilliHz, highMilliHz, resolutionPpb);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (count == -1) {
         return 1;
     }
+    snprintf(line, sizeof(line), "Wrote %lld entries (%.1f MB) at %u ppb to %s in %.1f s.", (long long)count,
+             (sizeof(Si5351IndexHeader) + count * sizeof(Si5351IndexEntry)) / 1e6, resolutionPpb, path,
+             elapsedMicroseconds(start, end) / 1e6);
+    std::cout << line << std::endl;
+    return 0;
+}
+
+/**
+ * Find this board's crystal in a calibration table and the target in its
+ * cache of calibrated register images, solving them on a cache miss.
+ *
+ * @param found Set to false if the board is not in the table.
+ * @return 0 on success or if the board is not listed, -1 on failure.
+ */
+int calibrate(const char *table, const char *board, const char *cacheDir, const char *target, Si5351Store *store,
+              const Si5351StoreEntry **entry, bool *found) {
+    char id[SI5351_BOARD_ID_LENGTH];
+    char cache[512];
+    char line[64];
+    char took[32];
+    uint64_t xtalHz;
+    int solved;
+    struct timespec start, end;
+
+    if (board != nullptr) {
+        snprintf(id, sizeof(id), "%s", board);
+    } else if (si5351BoardId(id, sizeof(id)) == -1) {
+        std::cerr << "No board ID; give one with --board." << std::endl;
+        return -1;
+    }
+    int listed = si5351LoadCalibration(table, id, &xtalHz);
+    *found = listed == 1;
+    if (listed != 1) {
+        if (listed == 0) {
+            std::cerr << "Board " << id << " is not in " << table << "; using the nominal crystal." << std::endl;
+        }
+        return listed;
+    }
 
+    si5351CalibrationCachePath(cacheDir, id, xtalHz, cache, sizeof(cache));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (si5351CalibratedPreset(cache, xtalHz, target, store, entry, &solved) == -1) {
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ppm = ((double)xtalHz / SI5351_XTAL_FREQUENCY - 1) * 1e6;
+    snprintf(line, sizeof(line), "crystal %llu Hz (%+.2f ppm); ", (unsigned long long)xtalHz, ppm);
+    snprintf(took, sizeof(took), " in %.0f us.", elapsedMicroseconds(start, end));
+    std::cout << "Board " << id << ": " << line;
+    if (solved > 0) {
+        std::cout << "solved " << solved << " frequencies into " << cache << took << std::endl;
+    } else {
+        std::cout << (*entry)->name << " from " << cache << took << std::endl;
+    }
+    return 0;
+}
 
-    // Disable Outputs
-    writeRegister(fd, SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 0xFF);
-
-    // Powerup only output #0
-    writeRegister(fd, SI5351_REGISTER_16_CLK0_CONTROL, 0x4F);
-    writeRegister(fd, SI5351_REGISTER_17_CLK1_CONTROL, 0x80);
-    writeRegister(fd, SI5351_REGISTER_18_CLK2_CONTROL, 0x80);
-    writeRegister(fd, SI5351_REGISTER_19_CLK3_CONTROL, 0x80);
-    writeRegister(fd, SI5351_REGISTER_20_CLK4_CONTROL, 0x80);
-    writeRegister(fd, SI5351_REGISTER_21_CLK5_CONTROL, 0x80);
-    writeRegister(fd, SI5351_REGISTER_22_CLK6_CONTROL, 0x80);
-    writeRegister(fd, SI5351_REGISTER_23_CLK7_CONTROL, 0x80);
-
-    writeRegister(fd, SI5351_REGISTER_24_CLK3_0_DISABLE_STATE, 0x00);
-    writeRegister(fd, SI5351_REGISTER_25_CLK7_4_DISABLE_STATE, 0x00);
-
-    // Test frequency: 10MHz
-    //
-
-    //  PLL A
-    //  Input Frequency (MHz) = 25,000000000
-    //  VCO Frequency (MHz) =  800,000000000
-    //  Feedback Divider = 32
-    //  SSC disabled
-    //
-    // Output Clocks
-    // Channel 0
-    //  Output Frequency (MHz) = 10,000000000
-    //  Multisynth Output Frequency (MHz) = 10,000000000
-    //  Multisynth Divider = 80
-    //  R Divider = 1
-    //  PLL source = PLLA
-    //  Initial phase offset (ns) = 0,000
-    //  Powered down = No
-    //  Inverted = No
-    //  Drive Strength = b11
-    //  Disable State = Low
-    //  Clock Source = b11
-
-    // writeRegister(fd, SI5351_REGISTER_26_PLL_A_REG0, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_27_PLL_A_REG1, 0x01);
-    // writeRegister(fd, SI5351_REGISTER_28_PLL_A_REG2, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_29_PLL_A_REG3, 0x0e);
-    // writeRegister(fd, SI5351_REGISTER_30_PLL_A_REG4, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_31_PLL_A_REG5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_32_PLL_A_REG6, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_33_PLL_A_REG7, 0x00);
-
-    // writeRegister(fd, SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_43_MULTISYNTH0_PARAMETERS_2, 0x01);
-    // writeRegister(fd, SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_45_MULTISYNTH0_PARAMETERS_4, 0x26);
-    // writeRegister(fd, SI5351_REGISTER_46_MULTISYNTH0_PARAMETERS_5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_47_MULTISYNTH0_PARAMETERS_6, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_48_MULTISYNTH0_PARAMETERS_7, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_49_MULTISYNTH0_PARAMETERS_8, 0x00);
-
-
-    // ATARI PAL: 1.773447000 Mhz
-    //
-
-    // PLL A
-    //  Input Frequency (MHz) = 25,000000000
-    //  VCO Frequency (MHz) =  698,738100000
-    //  Feedback Divider = 27  237381/250000
-    //  SSC disabled
-    //
-    // Output Clocks
-    // Channel 0
-    //  Output Frequency (MHz) = 1,773447000
-    //  Multisynth Output Frequency (MHz) = 1,773447000
-    //  Multisynth Divider = 394
-    //  R Divider = 1
-    //  PLL source = PLLA
-    //  Initial phase offset (ns) = 0,000
-    //  Powered down = No
-    //  Inverted = No
-    //  Drive Strength = b11
-    //  Disable State = Low
-    //  Clock Source = b11
-
-    writeRegister(fd, SI5351_REGISTER_26_PLL_A_REG0, 0xd0);
-    writeRegister(fd, SI5351_REGISTER_27_PLL_A_REG1, 0x90);
-    writeRegister(fd, SI5351_REGISTER_28_PLL_A_REG2, 0x00);
-    writeRegister(fd, SI5351_REGISTER_29_PLL_A_REG3, 0x0b);
-    writeRegister(fd, SI5351_REGISTER_30_PLL_A_REG4, 0xf9);
-    writeRegister(fd, SI5351_REGISTER_31_PLL_A_REG5, 0x32);
-    writeRegister(fd, SI5351_REGISTER_32_PLL_A_REG6, 0x0e);
-    writeRegister(fd, SI5351_REGISTER_33_PLL_A_REG7, 0x70);
-
-    writeRegister(fd, SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, 0x00);
-    writeRegister(fd, SI5351_REGISTER_43_MULTISYNTH0_PARAMETERS_2, 0x01);
-    writeRegister(fd, SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3, 0x00);
-    writeRegister(fd, SI5351_REGISTER_45_MULTISYNTH0_PARAMETERS_4, 0xc3);
-    writeRegister(fd, SI5351_REGISTER_46_MULTISYNTH0_PARAMETERS_5, 0x00);
-    writeRegister(fd, SI5351_REGISTER_47_MULTISYNTH0_PARAMETERS_6, 0x00);
-    writeRegister(fd, SI5351_REGISTER_48_MULTISYNTH0_PARAMETERS_7, 0x00);
-    writeRegister(fd, SI5351_REGISTER_49_MULTISYNTH0_PARAMETERS_8, 0x00);
-
-
-    // ATARI PAL: 3.546894 Mhz
-    //
-
-    // PLL A
-    //  Input Frequency (MHz) = 25,000000000
-    //  VCO Frequency (MHz) =  702,285000000
-    //  Feedback Divider = 28  457/5000
-    //  SSC disabled
-    //
-    // Output Clocks
-    // Channel 0
-    //  Output Frequency (MHz) = 3,546894000
-    //  Multisynth Output Frequency (MHz) = 3,546894000
-    //  Multisynth Divider = 198
-    //  R Divider = 1
-    //  PLL source = PLLA
-    //  Initial phase offset (ns) = 0,000
-    //  Powered down = No
-    //  Inverted = No
-    //  Drive Strength = b11
-    //  Disable State = Low
-    //  Clock Source = b11
-
-    // writeRegister(fd, SI5351_REGISTER_26_PLL_A_REG0, 0x13);
-    // writeRegister(fd, SI5351_REGISTER_27_PLL_A_REG1, 0x88);
-    // writeRegister(fd, SI5351_REGISTER_28_PLL_A_REG2, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_29_PLL_A_REG3, 0x0c);
-    // writeRegister(fd, SI5351_REGISTER_30_PLL_A_REG4, 0x0b);
-    // writeRegister(fd, SI5351_REGISTER_31_PLL_A_REG5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_32_PLL_A_REG6, 0x0d);
-    // writeRegister(fd, SI5351_REGISTER_33_PLL_A_REG7, 0xa8);
-
-    // writeRegister(fd, SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_43_MULTISYNTH0_PARAMETERS_2, 0x01);
-    // writeRegister(fd, SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_45_MULTISYNTH0_PARAMETERS_4, 0x61);
-    // writeRegister(fd, SI5351_REGISTER_46_MULTISYNTH0_PARAMETERS_5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_47_MULTISYNTH0_PARAMETERS_6, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_48_MULTISYNTH0_PARAMETERS_7, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_49_MULTISYNTH0_PARAMETERS_8, 0x00);
-
-
-    // ATARI PAL: 14.187576 MHz
-    //
-
-    // PLL A
-    //  Input Frequency (MHz) = 25,000000000
-    //  VCO Frequency (MHz) =  709,378800000
-    //  Feedback Divider = 28  23447/62500
-    //  SSC disabled
-    //
-    // Output Clocks
-    // Channel 0
-    //  Output Frequency (MHz) = 14,187576000
-    //  Multisynth Output Frequency (MHz) = 14,187576000
-    //  Multisynth Divider = 50
-    //  R Divider = 1
-    //  PLL source = PLLA
-    //  Initial phase offset (ns) = 0,000
-    //  Powered down = No
-    //  Inverted = No
-    //  Drive Strength = b11
-    //  Disable State = Low
-    //  Clock Source = b11
-
-    // writeRegister(fd, SI5351_REGISTER_26_PLL_A_REG0, 0xf4);
-    // writeRegister(fd, SI5351_REGISTER_27_PLL_A_REG1, 0x24);
-    // writeRegister(fd, SI5351_REGISTER_28_PLL_A_REG2, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_29_PLL_A_REG3, 0x0c);
-    // writeRegister(fd, SI5351_REGISTER_30_PLL_A_REG4, 0x30);
-    // writeRegister(fd, SI5351_REGISTER_31_PLL_A_REG5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_32_PLL_A_REG6, 0x04);
-    // writeRegister(fd, SI5351_REGISTER_33_PLL_A_REG7, 0xc0);
-
-    // writeRegister(fd, SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_43_MULTISYNTH0_PARAMETERS_2, 0x01);
-    // writeRegister(fd, SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_45_MULTISYNTH0_PARAMETERS_4, 0x17);
-    // writeRegister(fd, SI5351_REGISTER_46_MULTISYNTH0_PARAMETERS_5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_47_MULTISYNTH0_PARAMETERS_6, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_48_MULTISYNTH0_PARAMETERS_7, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_49_MULTISYNTH0_PARAMETERS_8, 0x00);
-
-
-    // ATARI 400/800 NTSC: 1.7897875 MHz
-    //
-
-    // PLL A
-    //  Input Frequency (MHz) = 25,000000000
-    //  VCO Frequency (MHz) =  698,017125000
-    //  Feedback Divider = 27  184137/200000
-    //  SSC disabled
-    //
-    // Output Clocks
-    // Channel 0
-    //  Output Frequency (MHz) = 1,789787500
-    //  Multisynth Output Frequency (MHz) = 1,789787500
-    //  Multisynth Divider = 390
-    //  R Divider = 1
-    //  PLL source = PLLA
-    //  Initial phase offset (ns) = 0,000
-    //  Powered down = No
-    //  Inverted = No
-    //  Drive Strength = b11
-    //  Disable State = Low
-    //  Clock Source = b11
-
-    // writeRegister(fd, SI5351_REGISTER_26_PLL_A_REG0, 0x0d);
-    // writeRegister(fd, SI5351_REGISTER_27_PLL_A_REG1, 0x40);
-    // writeRegister(fd, SI5351_REGISTER_28_PLL_A_REG2, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_29_PLL_A_REG3, 0x0b);
-    // writeRegister(fd, SI5351_REGISTER_30_PLL_A_REG4, 0xf5);
-    // writeRegister(fd, SI5351_REGISTER_31_PLL_A_REG5, 0x32);
-    // writeRegister(fd, SI5351_REGISTER_32_PLL_A_REG6, 0x96);
-    // writeRegister(fd, SI5351_REGISTER_33_PLL_A_REG7, 0x40);
-
-    // writeRegister(fd, SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_43_MULTISYNTH0_PARAMETERS_2, 0x01);
-    // writeRegister(fd, SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_45_MULTISYNTH0_PARAMETERS_4, 0xc1);
-    // writeRegister(fd, SI5351_REGISTER_46_MULTISYNTH0_PARAMETERS_5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_47_MULTISYNTH0_PARAMETERS_6, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_48_MULTISYNTH0_PARAMETERS_7, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_49_MULTISYNTH0_PARAMETERS_8, 0x00);
-
-
-    // ATARI 400/800 NTSC: 3.579575 MHz
-    //
-
-    // PLL A
-    //  Input Frequency (MHz) = 25,000000000
-    //  VCO Frequency (MHz) =  701,596700000
-    //  Feedback Divider = 28  15967/250000
-    //  SSC disabled
-    //
-    // Output Clocks
-    // Channel 0
-    //  Output Frequency (MHz) = 3,579575000
-    //  Multisynth Output Frequency (MHz) = 3,579575000
-    //  Multisynth Divider = 196
-    //  R Divider = 1
-    //  PLL source = PLLA
-    //  Initial phase offset (ns) = 0,000
-    //  Powered down = No
-    //  Inverted = No
-    //  Drive Strength = b11
-    //  Disable State = Low
-    //  Clock Source = b11
-
-    // writeRegister(fd, SI5351_REGISTER_26_PLL_A_REG0, 0xd0);
-    // writeRegister(fd, SI5351_REGISTER_27_PLL_A_REG1, 0x90);
-    // writeRegister(fd, SI5351_REGISTER_28_PLL_A_REG2, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_29_PLL_A_REG3, 0x0c);
-    // writeRegister(fd, SI5351_REGISTER_30_PLL_A_REG4, 0x08);
-    // writeRegister(fd, SI5351_REGISTER_31_PLL_A_REG5, 0x30);
-    // writeRegister(fd, SI5351_REGISTER_32_PLL_A_REG6, 0xab);
-    // writeRegister(fd, SI5351_REGISTER_33_PLL_A_REG7, 0x00);
-
-    // writeRegister(fd, SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_43_MULTISYNTH0_PARAMETERS_2, 0x01);
-    // writeRegister(fd, SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_45_MULTISYNTH0_PARAMETERS_4, 0x60);
-    // writeRegister(fd, SI5351_REGISTER_46_MULTISYNTH0_PARAMETERS_5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_47_MULTISYNTH0_PARAMETERS_6, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_48_MULTISYNTH0_PARAMETERS_7, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_49_MULTISYNTH0_PARAMETERS_8, 0x00);
-
-
-    // ATARI XL/XE NTSC: 1.7897725 Mhz
-    //
-
-    // PLL A
-    //  Input Frequency (MHz) = 25,000000000
-    //  VCO Frequency (MHz) =  698,011275000
-    //  Feedback Divider = 27  920451/1000000
-    //  SSC disabled
-    //
-    // Output Clocks
-    // Channel 0
-    //  Output Frequency (MHz) = 1,789772500
-    //  Multisynth Output Frequency (MHz) = 1,789772500
-    //  Multisynth Divider = 390
-    //  R Divider = 1
-    //  PLL source = PLLA
-    //  Initial phase offset (ns) = 0,000
-    //  Powered down = No
-    //  Inverted = No
-    //  Drive Strength = b11
-    //  Disable State = Low
-    //  Clock Source = b11
-
-    // writeRegister(fd, SI5351_REGISTER_26_PLL_A_REG0, 0x42);
-    // writeRegister(fd, SI5351_REGISTER_27_PLL_A_REG1, 0x40);
-    // writeRegister(fd, SI5351_REGISTER_28_PLL_A_REG2, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_29_PLL_A_REG3, 0x0b);
-    // writeRegister(fd, SI5351_REGISTER_30_PLL_A_REG4, 0xf5);
-    // writeRegister(fd, SI5351_REGISTER_31_PLL_A_REG5, 0xfc);
-    // writeRegister(fd, SI5351_REGISTER_32_PLL_A_REG6, 0x7a);
-    // writeRegister(fd, SI5351_REGISTER_33_PLL_A_REG7, 0x40);
-
-    // writeRegister(fd, SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_43_MULTISYNTH0_PARAMETERS_2, 0x01);
-    // writeRegister(fd, SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_45_MULTISYNTH0_PARAMETERS_4, 0xc1);
-    // writeRegister(fd, SI5351_REGISTER_46_MULTISYNTH0_PARAMETERS_5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_47_MULTISYNTH0_PARAMETERS_6, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_48_MULTISYNTH0_PARAMETERS_7, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_49_MULTISYNTH0_PARAMETERS_8, 0x00);
-
-
-    // ATARI XL/XE NTSC: 3.579545 Mhz
-    //
-
-    // PLL A
-    //  Input Frequency (MHz) = 25,000000000
-    //  VCO Frequency (MHz) =  701,590800000
-    //  Feedback Divider = 28  3977/62500
-    //  SSC disabled
-    //
-    // Output Clocks
-    // Channel 0
-    //  Output Frequency (MHz) = 3,579545000
-    //  Multisynth Output Frequency (MHz) = 3,579545000
-    //  Multisynth Divider = 196
-    //  R Divider = 1
-    //  PLL source = PLLA
-    //  Initial phase offset (ns) = 0,000
-    //  Powered down = No
-    //  Inverted = No
-    //  Drive Strength = b11
-    //  Disable State = Low
-    //  Clock Source = b11
-
-    // writeRegister(fd, SI5351_REGISTER_26_PLL_A_REG0, 0xf4);
-    // writeRegister(fd, SI5351_REGISTER_27_PLL_A_REG1, 0x24);
-    // writeRegister(fd, SI5351_REGISTER_28_PLL_A_REG2, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_29_PLL_A_REG3, 0x0c);
-    // writeRegister(fd, SI5351_REGISTER_30_PLL_A_REG4, 0x08);
-    // writeRegister(fd, SI5351_REGISTER_31_PLL_A_REG5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_32_PLL_A_REG6, 0x23);
-    // writeRegister(fd, SI5351_REGISTER_33_PLL_A_REG7, 0x60);
-
-    // writeRegister(fd, SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_43_MULTISYNTH0_PARAMETERS_2, 0x01);
-    // writeRegister(fd, SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_45_MULTISYNTH0_PARAMETERS_4, 0x60);
-    // writeRegister(fd, SI5351_REGISTER_46_MULTISYNTH0_PARAMETERS_5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_47_MULTISYNTH0_PARAMETERS_6, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_48_MULTISYNTH0_PARAMETERS_7, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_49_MULTISYNTH0_PARAMETERS_8, 0x00);
-
-
-    // ATARI XL/XE NTSC: 14.31818 Mhz
-    //
-
-    // PLL A
-    //  Input Frequency (MHz) = 25,000000000
-    //  VCO Frequency (MHz) =  687,272640000
-    //  Feedback Divider = 27  38352/78125
-    //  SSC disabled
-    //
-    // Output Clocks
-    // Channel 0
-    //  Output Frequency (MHz) = 14,318180000
-    //  Multisynth Output Frequency (MHz) = 14,318180000
-    //  Multisynth Divider = 48
-    //  R Divider = 1
-    //  PLL source = PLLA
-    //  Initial phase offset (ns) = 0,000
-    //  Powered down = No
-    //  Inverted = No
-    //  Drive Strength = b11
-    //  Disable State = Low
-    //  Clock Source = b11
-
-    // writeRegister(fd, SI5351_REGISTER_26_PLL_A_REG0, 0x31);
-    // writeRegister(fd, SI5351_REGISTER_27_PLL_A_REG1, 0x2d);
-    // writeRegister(fd, SI5351_REGISTER_28_PLL_A_REG2, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_29_PLL_A_REG3, 0x0b);
-    // writeRegister(fd, SI5351_REGISTER_30_PLL_A_REG4, 0xbe);
-    // writeRegister(fd, SI5351_REGISTER_31_PLL_A_REG5, 0x10);
-    // writeRegister(fd, SI5351_REGISTER_32_PLL_A_REG6, 0xff);
-    // writeRegister(fd, SI5351_REGISTER_33_PLL_A_REG7, 0x1a);
-
-    // writeRegister(fd, SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_43_MULTISYNTH0_PARAMETERS_2, 0x01);
-    // writeRegister(fd, SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_45_MULTISYNTH0_PARAMETERS_4, 0x16);
-    // writeRegister(fd, SI5351_REGISTER_46_MULTISYNTH0_PARAMETERS_5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_47_MULTISYNTH0_PARAMETERS_6, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_48_MULTISYNTH0_PARAMETERS_7, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_49_MULTISYNTH0_PARAMETERS_8, 0x00);
-
-
-    // ATARI PAL crystal: 4.433618 MHz
-    //
-
-    // PLL A
-    //  Input Frequency (MHz) = 25,000000000
-    //  VCO Frequency (MHz) =  700,511640000
-    //  Feedback Divider = 28  12791/625000
-    //  SSC disabled
-    //
-    // Output Clocks
-    // Channel 0
-    //  Output Frequency (MHz) = 4,433618000
-    //  Multisynth Output Frequency (MHz) = 4,433618000
-    //  Multisynth Divider = 158
-    //  R Divider = 1
-    //  PLL source = PLLA
-    //  Initial phase offset (ns) = 0,000
-    //  Powered down = No
-    //  Inverted = No
-    //  Drive Strength = b11
-    //  Disable State = Low
-    //  Clock Source = b11
-
-    // writeRegister(fd, SI5351_REGISTER_26_PLL_A_REG0, 0x89);
-    // writeRegister(fd, SI5351_REGISTER_27_PLL_A_REG1, 0x68);
-    // writeRegister(fd, SI5351_REGISTER_28_PLL_A_REG2, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_29_PLL_A_REG3, 0x0c);
-    // writeRegister(fd, SI5351_REGISTER_30_PLL_A_REG4, 0x02);
-    // writeRegister(fd, SI5351_REGISTER_31_PLL_A_REG5, 0x95);
-    // writeRegister(fd, SI5351_REGISTER_32_PLL_A_REG6, 0xe8);
-    // writeRegister(fd, SI5351_REGISTER_33_PLL_A_REG7, 0xb0);
-
-    // writeRegister(fd, SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_43_MULTISYNTH0_PARAMETERS_2, 0x01);
-    // writeRegister(fd, SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_45_MULTISYNTH0_PARAMETERS_4, 0x4d);
-    // writeRegister(fd, SI5351_REGISTER_46_MULTISYNTH0_PARAMETERS_5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_47_MULTISYNTH0_PARAMETERS_6, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_48_MULTISYNTH0_PARAMETERS_7, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_49_MULTISYNTH0_PARAMETERS_8, 0x00);
-
-
-    // ATARI XF551 crystal: 8.3333 Mhz
-    //
-
-    // PLL A
-    //  Input Frequency (MHz) = 25,000000000
-    //  VCO Frequency (MHz) =  716,663800000
-    //  Feedback Divider = 28  83319/125000
-    //  SSC disabled
-    //
-    // Output Clocks
-    // Channel 0
-    //  Output Frequency (MHz) = 8,333300000
-    //  Multisynth Output Frequency (MHz) = 8,333300000
-    //  Multisynth Divider = 86
-    //  R Divider = 1
-    //  PLL source = PLLA
-    //  Initial phase offset (ns) = 0,000
-    //  Powered down = No
-    //  Inverted = No
-    //  Drive Strength = b11
-    //  Disable State = Low
-    //  Clock Source = b11
-
-    // writeRegister(fd, SI5351_REGISTER_26_PLL_A_REG0, 0xe8);
-    // writeRegister(fd, SI5351_REGISTER_27_PLL_A_REG1, 0x48);
-    // writeRegister(fd, SI5351_REGISTER_28_PLL_A_REG2, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_29_PLL_A_REG3, 0x0c);
-    // writeRegister(fd, SI5351_REGISTER_30_PLL_A_REG4, 0x55);
-    // writeRegister(fd, SI5351_REGISTER_31_PLL_A_REG5, 0x10);
-    // writeRegister(fd, SI5351_REGISTER_32_PLL_A_REG6, 0x9b);
-    // writeRegister(fd, SI5351_REGISTER_33_PLL_A_REG7, 0x98);
-
-    // writeRegister(fd, SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_43_MULTISYNTH0_PARAMETERS_2, 0x01);
-    // writeRegister(fd, SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_45_MULTISYNTH0_PARAMETERS_4, 0x29);
-    // writeRegister(fd, SI5351_REGISTER_46_MULTISYNTH0_PARAMETERS_5, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_47_MULTISYNTH0_PARAMETERS_6, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_48_MULTISYNTH0_PARAMETERS_7, 0x00);
-    // writeRegister(fd, SI5351_REGISTER_49_MULTISYNTH0_PARAMETERS_8, 0x00);
-
-
-    // Apply PLLA and PLLB soft reset
-    writeRegister(fd, SI5351_REGISTER_177_PLL_RESET, 0xAC);
-
-    // Enable desired outputs
-    writeRegister(fd, SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 0);
-
-    std::cout << "The setup for CLK0 has been completed." << std::endl;
+/**
+ * Analyse every preset over crystal tolerance and drift and print one
+ * CSV row or JSON object per preset; the totals go to standard error.
+ *
+ * @return 0 on success, 1 on invalid options.
+ */
+int analyzeTolerance(const Si5351ToleranceOptions &options, bool json) {
+    static Si5351ToleranceTarget targets[sizeof(SI5351_PRESETS) / sizeof(SI5351_PRESETS[0])];
+    static Si5351Tolerance tolerance;
+    int count = 0;
+    char line[400];
+
+    for (const Si5351Preset &preset : SI5351_PRESETS) {
+        targets[count++] = Si5351ToleranceTarget{ preset.name, preset.outputMilliHz, preset.image };
+    }
+    if (si5351AnalyzeTolerance(targets, count, options, &tolerance) == -1) {
+        std::cerr << "Expected a sample count above 0 and tolerances of at least 0 ppm." << std::endl;
+        return 1;
+    }
+
+    if (json) {
+        snprintf(line, sizeof(line), "{\"tolerance_ppm\": %g, \"drift_ppm\": %g, \"samples\": %llu, \"sampling\": \"%s\", "
+                 "\"limit_ppm\": %g, \"presets\": [", options.tolerancePpm, options.driftPpm, (unsigned long long)tolerance.samples,
+                 options.grid ? "grid" : "monte_carlo", options.limitPpm);
+        std::cout << line << std::endl;
+    } else {
+        std::cout << "preset,target_hz,nominal_ppb,min_ppm,max_ppm,mean_ppm,stddev_ppm,p1_ppm,p50_ppm,p99_ppm,within_limit,"
+                     "vco_min_mhz,vco_max_mhz,vco_violations" << std::endl;
+    }
+    for (int i = 0; i < count; i++) {
+        const Si5351ToleranceResult &result = tolerance.results[i];
+        const char *format = json ? "  {\"preset\": \"%s\", \"target_hz\": %.3f, \"nominal_ppb\": %.6f, \"min_ppm\": %.6f, "
+                                    "\"max_ppm\": %.6f, \"mean_ppm\": %.6f, \"stddev_ppm\": %.6f, \"p1_ppm\": %.4f, "
+                                    "\"p50_ppm\": %.4f, \"p99_ppm\": %.4f, \"within_limit\": %.6f, \"vco_min_mhz\": %.6f, "
+                                    "\"vco_max_mhz\": %.6f, \"vco_violations\": %llu}%s"
+                                  : "%s,%.3f,%.6f,%.6f,%.6f,%.6f,%.6f,%.4f,%.4f,%.4f,%.6f,%.6f,%.6f,%llu%s";
+        snprintf(line, sizeof(line), format, targets[i].name, targets[i].outputMilliHz / 1000.0, result.nominalPpb, result.minPpm,
+                 result.maxPpm, result.meanPpm, result.stddevPpm, result.p1Ppm, result.p50Ppm, result.p99Ppm, result.withinLimit,
+                 result.vcoMinMHz, result.vcoMaxMHz, (unsigned long long)result.vcoViolations,
+                 json && i + 1 < count ? "," : "");
+        std::cout << line << std::endl;
+    }
+    if (json) {
+        std::cout << "]}" << std::endl;
+    }
 
+    snprintf(line, sizeof(line), "%d presets x %llu samples on %d threads in %.1f ms (%.1f M evaluations/s)", count,
+             (unsigned long long)tolerance.samples, tolerance.threads, tolerance.elapsedNs / 1e6,
+             count * tolerance.samples / (tolerance.elapsedNs / 1e3));
+    std::cerr << line << std::endl;
     return 0;
 }
+
+void printUsage(const char *program) {
+    std::cerr << "Usage: " << program << " [--simulate] [--bus-speed <Hz>] [--stats[=json]] [--lock-deadline <ms>] [--warm] [--verify[-only] [--repair]] [--trace <file> [--trace-size <KB>]] [--store <file>] [preset | --frequency <Hz> | --plan <Hz>,<Hz>,...]" << std::endl
+              << "       " << program << " --monitor [--reapply] [--monitor-interval <min ms>,<max ms>] [options and configuration as above]" << std::endl
+              << "       " << program << " --calibration <table> [--board <id>] [--calibration-cache <dir>] [options as above] [preset | --frequency <Hz>]" << std::endl
+              << "       " << program << " --trim [--simulate] [--bus-speed <Hz>] [--stats[=json]] [preset | --frequency <Hz>]   (ppb offsets on standard input)" << std::endl
+              << "       " << program << " --ping-pong <A>,<B> [--simulate] [--bus-speed <Hz>] [--stats[=json]] [--lock-deadline <ms>]   (presets or frequencies on standard input)" << std::endl
+              << "       " << program << " --trim-report [--simulate] [--bus-speed <Hz>]" << std::endl
+              << "       " << program << " --daemon [--simulate] [--bus-speed <Hz>] [--stats[=json]] [--socket <path>]" << std::endl
+              << "       " << program << " --watch <config> [--simulate] [--bus-speed <Hz>] [--stats[=json]] [--lock-deadline <ms>]" << std::endl
+              << "       " << program << " --sequence <timeline> [--realtime] [--simulate] [--bus-speed <Hz>] [--stats[=json]] [--lock-deadline <ms>]" << std::endl
+              << "       " << program << " --fleet <manifest> [--simulate] [--bus-speed <Hz>] [--lock-deadline <ms>]" << std::endl
+              << "       " << program << " --search <Hz>,<Hz>,... [--threads <n>] [--vco-step <Hz>] [--penalty-weight <ppb>]" << std::endl
+              << "       " << program << " --analyze[=json] [--xtal-tolerance <ppm>] [--xtal-drift <ppm>] [--samples <n>] [--grid] [--limit <ppm>] [--seed <n>] [--threads <n>]" << std::endl
+              << "       " << program << " --index <file> [--tolerance <ppb>] --frequency <Hz> [other options as above]" << std::endl
+              << "       " << program << " --build-index <file> <low Hz> <high Hz> [--resolution <ppb>]" << std::endl
+              << "       " << program << " --import <file> [<name>=]<export>..." << std::endl
+              << "       " << program << " --check | --list [--store <file>]" << std::endl
+              << "Presets:" << std::endl;
+    printPresets();
+}
+
+int main(int argc, char *argv[]) {
+
+    // Default to Atari XL/XE PAL 1.773447 MHz
+    const Si5351Preset *preset = &SI5351_PRESETS[0];
+    Si5351RegisterImage image = preset->image;
+    const char *frequency = nullptr;
+    const char *socketPath = SI5351_DAEMON_SOCKET;
+    bool daemon = false;
+    bool simulate = false;
+    uint32_t busHz = 100000;
+    bool stats = false;
+    bool statsJson = false;
+    static Si5351BusStats busStats;
+    Si5351Lock lock = {};
+    lock.deadlineUs = SI5351_LOCK_DEADLINE_US;
+    const char *searchList = nullptr;
+    const char *manifest = nullptr;
+    const char *watchPath = nullptr;
+    const char *timeline = nullptr;
+    bool realtime = false;
+    bool trim = false;
+    bool trimReport = false;
+    bool verify = false;
+    bool verifyOnly = false;
+    bool repair = false;
+    bool warm = false;
+    Si5351SearchOptions searchOptions = { 0, SI5351_SEARCH_VCO_STEP_HZ, SI5351_SEARCH_PENALTY_WEIGHT_PPB };
+    static Si5351Plan plan;
+    bool planned = false;
+    bool list = false;
+    const char *storePath = nullptr;
+    const char *presetName = nullptr;
+    const char *indexPath = nullptr;
+    const char *lowHz = nullptr;
+    const char *highHz = nullptr;
+    uint32_t resolutionPpb = SI5351_INDEX_RESOLUTION_PPB;
+    double tolerancePpb = -1;
+    Si5351Store store = {};
+    const Si5351StoreEntry *stored = nullptr;
+    bool monitor = false;
+    const char *pingPongPair = nullptr;
+    const char *tracePath = nullptr;
+    const char *calibrationPath = nullptr;
+    bool analyze = false;
+    bool analyzeJson = false;
+    Si5351ToleranceOptions toleranceOptions = { SI5351_TOLERANCE_PPM, SI5351_TOLERANCE_DRIFT_PPM, SI5351_TOLERANCE_SAMPLES, false, 0, 1, 0 };
+    const char *board = nullptr;
+    const char *cacheDir = SI5351_CALIBRATION_CACHE_DIR;
+    uint32_t traceSize = SI5351_TRACE_SIZE;
+    Si5351MonitorOptions monitorOptions = { SI5351_MONITOR_INTERVAL_MIN_MS, SI5351_MONITOR_INTERVAL_MAX_MS, false, 0 };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--list") == 0) {
+            list = true;
+        } else if (strcmp(argv[i], "--import") == 0 && i + 2 < argc) {
+            return importPresets(argv[i + 1], argv + i + 2, argc - i - 2);
+        } else if (strcmp(argv[i], "--store") == 0 && i + 1 < argc) {
+            storePath = argv[++i];
+        } else if (strcmp(argv[i], "--check") == 0) {
+            return checkSolver() == 0 ? 0 : 1;
+        } else if (strcmp(argv[i], "--daemon") == 0) {
+            daemon = true;
+        } else if (strcmp(argv[i], "--simulate") == 0) {
+            simulate = true;
+        } else if (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats=json") == 0) {
+            stats = true;
+            statsJson = argv[i][7] == '=';
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            verify = true;
+        } else if (strcmp(argv[i], "--verify-only") == 0) {
+            verify = verifyOnly = true;
+        } else if (strcmp(argv[i], "--warm") == 0) {
+            warm = true;
+        } else if (strcmp(argv[i], "--repair") == 0) {
+            verify = repair = true;
+        } else if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc) {
+            watchPath = argv[++i];
+        } else if (strcmp(argv[i], "--sequence") == 0 && i + 1 < argc) {
+            timeline = argv[++i];
+        } else if (strcmp(argv[i], "--realtime") == 0) {
+            realtime = true;
+        } else if (strcmp(argv[i], "--analyze") == 0 || strcmp(argv[i], "--analyze=json") == 0) {
+            analyze = true;
+            analyzeJson = argv[i][9] == '=';
+        } else if (strcmp(argv[i], "--xtal-tolerance") == 0 && i + 1 < argc) {
+            toleranceOptions.tolerancePpm = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--xtal-drift") == 0 && i + 1 < argc) {
+            toleranceOptions.driftPpm = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            toleranceOptions.samples = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--grid") == 0) {
+            toleranceOptions.grid = true;
+        } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+            toleranceOptions.limitPpm = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            toleranceOptions.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--calibration") == 0 && i + 1 < argc) {
+            calibrationPath = argv[++i];
+        } else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) {
+            board = argv[++i];
+        } else if (strcmp(argv[i], "--calibration-cache") == 0 && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (strcmp(argv[i], "--trace-size") == 0 && i + 1 < argc) {
+            // 1 KB holds the largest record (8 messages of a full burst)
+            char *end;
+            unsigned long kilobytes = strtoul(argv[++i], &end, 10);
+            if (*end != '\0' || kilobytes < 1 || kilobytes > UINT32_MAX / 1024) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            traceSize = (uint32_t)kilobytes * 1024;
+        } else if (strcmp(argv[i], "--ping-pong") == 0 && i + 1 < argc) {
+            pingPongPair = argv[++i];
+        } else if (strcmp(argv[i], "--monitor") == 0) {
+            monitor = true;
+        } else if (strcmp(argv[i], "--reapply") == 0) {
+            monitorOptions.reapply = true;
+        } else if (strcmp(argv[i], "--monitor-interval") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%u,%u", &monitorOptions.minIntervalMs, &monitorOptions.maxIntervalMs) != 2 ||
+                monitorOptions.minIntervalMs == 0 || monitorOptions.maxIntervalMs < monitorOptions.minIntervalMs) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--trim") == 0) {
+            trim = true;
+        } else if (strcmp(argv[i], "--trim-report") == 0) {
+            trimReport = true;
+        } else if (strcmp(argv[i], "--fleet") == 0 && i + 1 < argc) {
+            manifest = argv[++i];
+        } else if (strcmp(argv[i], "--search") == 0 && i + 1 < argc) {
+            searchList = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            searchOptions.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--vco-step") == 0 && i + 1 < argc) {
+            searchOptions.vcoStepHz = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--penalty-weight") == 0 && i + 1 < argc) {
+            searchOptions.penaltyWeightPpb = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--lock-deadline") == 0 && i + 1 < argc) {
+            lock.deadlineUs = (uint32_t)strtoul(argv[++i], nullptr, 10) * 1000;
+        } else if (strcmp(argv[i], "--bus-speed") == 0 && i + 1 < argc) {
+            busHz = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (strcmp(argv[i], "--frequency") == 0 && i + 1 < argc) {
+            frequency = argv[++i];
+            presetName = nullptr;
+        } else if (strcmp(argv[i], "--build-index") == 0 && i + 3 < argc) {
+            indexPath = argv[++i];
+            lowHz = argv[++i];
+            highHz = argv[++i];
+        } else if (strcmp(argv[i], "--resolution") == 0 && i + 1 < argc) {
+            resolutionPpb = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--index") == 0 && i + 1 < argc) {
+            indexPath = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerancePpb = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--plan") == 0 && i + 1 < argc) {
+            uint64_t outputMilliHz[SI5351_PLAN_MAX_OUTPUTS];
+            int count = parseFrequencyList(argv[++i], outputMilliHz, SI5351_PLAN_MAX_OUTPUTS);
+            if (count < 1) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            if (si5351Plan(outputMilliHz, count, SI5351_XTAL_FREQUENCY, &plan) == -1) {
+                std::cerr << "No frequency plan for these outputs." << std::endl;
+                return 1;
+            }
+            printPlan(plan);
+            planned = true;
+        } else {
+            presetName = argv[i];
+            frequency = nullptr;
+        }
+    }
+
+    if (lowHz != nullptr) {
+        return buildIndex(indexPath, lowHz, highHz, resolutionPpb);
+    }
+    if (analyze) {
+        toleranceOptions.threads = searchOptions.threads;
+        return analyzeTolerance(toleranceOptions, analyzeJson);
+    }
+    if (calibrationPath != nullptr) {
+        bool found;
+        if (planned || storePath != nullptr || indexPath != nullptr || trim) {
+            std::cerr << "--calibration works with a preset or --frequency." << std::endl;
+            return 1;
+        }
+        if (calibrate(calibrationPath, board, cacheDir, frequency != nullptr ? frequency : presetName != nullptr ? presetName : preset->name,
+                      &store, &stored, &found) == -1) {
+            return 1;
+        }
+        if (found) {
+            // Programmed from the cache like a stored preset
+            frequency = nullptr;
+            presetName = nullptr;
+        }
+    }
+    if (frequency != nullptr) {
+        static Si5351Index index;
+        uint64_t outputMilliHz;
+        Si5351Solution solution;
+        bool indexed = false;
+        if (si5351ParseMilliHz(frequency, &outputMilliHz) == -1) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (indexPath != nullptr && si5351OpenIndex(indexPath, &index) == -1) {
+            return 1;
+        }
+        if (tolerancePpb < 0) {
+            tolerancePpb = indexPath != nullptr ? index.header->resolutionPpb / 2.0 : 0;
+        }
+        if (si5351LookupFrequency(indexPath != nullptr ? &index : nullptr, outputMilliHz, tolerancePpb, &solution, &indexed) == -1) {
+            std::cerr << "Frequency out of range." << std::endl;
+            return 1;
+        }
+        std::cout << "Output Frequency (Hz) = " << frequency << std::endl;
+        printSolution(solution);
+        if (indexPath != nullptr) {
+            std::cout << (indexed ? "  Found in the index" : "  Solved, no index entry within tolerance") << " (" << tolerancePpb << " ppb)" << std::endl;
+            si5351CloseIndex(&index);
+        }
+        preset = nullptr;
+        image = solution.image;
+    }
+
+    if (trim && (planned || storePath != nullptr)) {
+        std::cerr << "--trim works with a preset or --frequency." << std::endl;
+        return 1;
+    }
+    if (storePath != nullptr && si5351OpenStore(storePath, &store) == -1) {
+        return 1;
+    }
+    if (list) {
+        printUsage(argv[0]);
+        if (storePath != nullptr) {
+            printStoredPresets(store);
+        }
+        return 0;
+    }
+    if (presetName != nullptr) {
+        // A stored preset takes precedence over a built-in one of the same name
+        stored = storePath != nullptr ? si5351FindStoredPreset(store, presetName) : nullptr;
+        preset = stored == nullptr ? si5351FindPreset(presetName) : nullptr;
+        if (stored == nullptr && preset == nullptr) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (preset != nullptr) {
+            image = preset->image;
+        }
+    }
+
+    if (searchList != nullptr) {
+        uint64_t outputMilliHz[SI5351_PLAN_MAX_OUTPUTS];
+        int count = parseFrequencyList(searchList, outputMilliHz, SI5351_PLAN_MAX_OUTPUTS);
+        if (count < 1) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return searchDividers(outputMilliHz, count, searchOptions);
+    }
+
+    // Solve every step before the bus is opened
+    static Si5351Sequence sequence;
+    if (timeline != nullptr && si5351LoadSequence(timeline, &sequence) == -1) {
+        return 1;
+    }
+
+    if (manifest != nullptr) {
+        static Si5351Fleet fleet;
+        if (si5351LoadFleet(manifest, &fleet) == -1) {
+            return 1;
+        }
+        Si5351FleetOptions fleetOptions = { simulate, busHz, lock.deadlineUs };
+        int failures = si5351ProgramFleet(&fleet, fleetOptions);
+        printFleet(fleet);
+        return failures == 0 ? 0 : 1;
+    }
+
+    // I2C bus initialization
+    Si5351I2cTransport i2c;
+    Si5351Simulator simulator(busHz);
+    Si5351Transport *transport = &simulator;
+    if (!simulate) {
+        if (i2c.open() == -1) {
+            std::cerr << "I2C initialization error." << std::endl;
+            return 1;
+        }
+        transport = &i2c;
+    }
+    if (stats) {
+        busStats.busHz = busHz;
+        transport->stats = &busStats;
+    }
+    static Si5351Trace trace;
+    std::vector<uint8_t> traceBuffer;
+    if (tracePath != nullptr) {
+        traceBuffer.resize(traceSize);
+        si5351TraceInit(&trace, traceBuffer.data(), traceSize);
+        transport->trace = &trace;
+    }
+
+    Si5351RegisterMap map;
+    if (planned) {
+        si5351MapPlan(plan, &map);
+    } else if (stored != nullptr) {
+        si5351MapStored(store, *stored, &map);
+    } else {
+        si5351MapClock0(image, 0x00, &map);
+    }
+
+    int result = 0;
+    if (daemon) {
+        result = si5351RunDaemon(transport, socketPath) == 0 ? 0 : 1;
+    } else if (watchPath != nullptr) {
+        result = si5351Watch(transport, watchPath, lock.deadlineUs) == 0 ? 0 : 1;
+    } else if (timeline != nullptr) {
+        Si5351SequenceOptions sequenceOptions = { realtime, lock.deadlineUs };
+        result = si5351PlaySequence(transport, &sequence, sequenceOptions) == 0 ? 0 : 1;
+        printSequence(sequence);
+    } else if (trimReport) {
+        result = reportTrim(transport);
+    } else if (pingPongPair != nullptr) {
+        result = pingPongFromInput(transport, pingPongPair, &lock, busHz);
+    } else if (verifyOnly) {
+        // Check what an earlier run left in the chip
+    } else if ((warm      ? warmStart(transport, map, &lock)
+                : planned ? si5351ConfigurePlan(transport, plan, &lock)
+                : stored  ? si5351ConfigureStored(transport, store, *stored, &lock)
+                          : si5351ConfigureClock0(transport, image, 0x00, &lock)) == -1) {
+        if (lock.timedOut) {
+            printLockTimeout(lock);
+        } else {
+            std::cerr << "Register write error." << std::endl;
+        }
+        result = 1;
+    } else {
+        if (lock.locked) {
+            printLock(lock);
+        }
+        if (planned) {
+            std::cout << "The setup for " << plan.outputCount << " outputs has been completed." << std::endl;
+        } else if (stored != nullptr) {
+            std::cout << "Stored preset " << stored->name << " programmed (" << stored->registerCount << " registers)." << std::endl;
+        } else if (preset != nullptr) {
+            std::cout << "CLK0 set to " << preset->name << " MHz (" << preset->description << ")." << std::endl;
+        } else {
+            std::cout << "CLK0 set to " << frequency << " Hz." << std::endl;
+        }
+        if (trim) {
+            result = trimFromInput(transport, image);
+        }
+    }
+
+    // A trim leaves registers 31-33 off the image on purpose
+    bool oneShot = !daemon && watchPath == nullptr && timeline == nullptr && !trim && !trimReport && pingPongPair == nullptr;
+    if (verify && oneShot && result == 0) {
+        result = verifyRegisters(transport, map, repair, lock.deadlineUs);
+    }
+
+    // Watch over what was just programmed, or with --verify-only what an earlier run left
+    if (monitor && oneShot && result == 0) {
+        static Si5351MonitorStats monitorStats;
+        monitorOptions.lockDeadlineUs = lock.deadlineUs;
+        if (simulate) {
+            signal(SIGUSR1, simulateFault);
+            signal(SIGUSR2, simulateFault);
+        }
+        si5351Monitor(transport, map, monitorOptions, &monitorStats);
+        printMonitor(monitorStats, busHz);
+    }
+
+    if (simulate && !daemon) {
+        printSimulatorTotals(simulator, busHz);
+    }
+    if (stats) {
+        fflush(stdout);
+        si5351PrintStats(stdout, busStats, statsJson);
+    }
+    if (tracePath != nullptr) {
+        if (si5351SaveTrace(trace, tracePath) == -1) {
+            result = 1;
+        } else {
+            std::cout << "Traced " << trace.records << " transfers to " << tracePath << " (" << trace.dropped << " dropped)." << std::endl;
+        }
+    }
+    if (storePath != nullptr) {
+        si5351CloseStore(&store);
+    }
+
+    return result;
+}
@@ -0,0 +1,188 @@
+/*
+ * SI5351 frequency index
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Si5351FrequencyIndex.h"
+
+/**
+ * Output frequency in millihertz that a CLK0 image produces.
+ */
+static uint64_t imageMilliHz(const Si5351RegisterImage &image, uint64_t xtalHz) {
+    Si5351Parameters multiSynth = si5351Unpack(image.multiSynth);
+    int rDividerLog2 = (image.multiSynth[2] >> 4) & 0x07;
+    long double vco = (long double)xtalHz * 1000 * si5351DividerValue(si5351Unpack(image.pll));
+    return (uint64_t)llroundl(vco / si5351DividerValue(multiSynth) / (1 << rDividerLog2));
+}
+
+int64_t si5351WriteIndex(const char *path, uint64_t lowMilliHz, uint64_t highMilliHz, uint32_t resolutionPpb) {
+    if (lowMilliHz == 0 || highMilliHz < lowMilliHz || resolutionPpb == 0) {
+        return -1;
+    }
+
+    char temporary[512];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    FILE *file = fopen(temporary, "wb");
+    if (file == nullptr) {
+        perror("Failed to create the index");
+        return -1;
+    }
+
+    Si5351IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SI5351_INDEX_MAGIC, sizeof(header.magic));
+    header.version = SI5351_INDEX_VERSION;
+    header.entrySize = sizeof(Si5351IndexEntry);
+    header.resolutionPpb = resolutionPpb;
+    header.xtalHz = SI5351_XTAL_FREQUENCY;
+    header.lowMilliHz = lowMilliHz;
+    header.highMilliHz = highMilliHz;
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    // Geometric grid; an image that does not move past the last one is dropped
+    double step = 1 + resolutionPpb * 1e-9;
+    double next = (double)lowMilliHz;
+    uint64_t last = 0;
+    for (uint64_t k = 0; written && next <= highMilliHz * (1 + 1e-12); k++) {
+        uint64_t milliHz = (uint64_t)llround(next);
+        next = lowMilliHz * pow(step, (double)(k + 1));
+
+        Si5351Solution solution;
+        if (si5351SolveFrequency(milliHz, SI5351_XTAL_FREQUENCY, 0, &solution) == -1) {
+            continue;
+        }
+        Si5351IndexEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.milliHz = imageMilliHz(solution.image, SI5351_XTAL_FREQUENCY);
+        entry.image = solution.image;
+        if (entry.milliHz <= last) {
+            continue;
+        }
+        last = entry.milliHz;
+        written = fwrite(&entry, sizeof(entry), 1, file) == 1;
+        header.count++;
+    }
+
+    // The count is known only now
+    written = written && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+    if (fclose(file) != 0 || !written || rename(temporary, path) != 0) {
+        perror("Failed to write the index");
+        unlink(temporary);
+        return -1;
+    }
+    return (int64_t)header.count;
+}
+
+int si5351OpenIndex(const char *path, Si5351Index *index) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open the index");
+        return -1;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) < 0 || (size_t)status.st_size < sizeof(Si5351IndexHeader)) {
+        fprintf(stderr, "%s: not a frequency index\n", path);
+        close(fd);
+        return -1;
+    }
+    void *base = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Failed to map the index");
+        return -1;
+    }
+
+    index->base = (const uint8_t *)base;
+    index->size = status.st_size;
+    index->header = (const Si5351IndexHeader *)base;
+    index->entries = (const Si5351IndexEntry *)(index->base + sizeof(Si5351IndexHeader));
+
+    const Si5351IndexHeader &header = *index->header;
+    const char *problem = nullptr;
+    if (memcmp(header.magic, SI5351_INDEX_MAGIC, sizeof(header.magic)) != 0) {
+        problem = "not a frequency index";
+    } else if (header.version != SI5351_INDEX_VERSION || header.entrySize != sizeof(Si5351IndexEntry)) {
+        problem = "unsupported index version";
+    } else if (header.xtalHz != SI5351_XTAL_FREQUENCY) {
+        problem = "index built for another crystal";
+    } else if (sizeof(Si5351IndexHeader) + header.count * sizeof(Si5351IndexEntry) != index->size) {
+        problem = "truncated index";
+    }
+    if (problem != nullptr) {
+        fprintf(stderr, "%s: %s\n", path, problem);
+        si5351CloseIndex(index);
+        return -1;
+    }
+
+    // Lookups walk the file at random
+    madvise(base, index->size, MADV_RANDOM);
+    return 0;
+}
+
+void si5351CloseIndex(Si5351Index *index) {
+    if (index->base != nullptr) {
+        munmap((void *)index->base, index->size);
+        index->base = nullptr;
+    }
+}
+
+const Si5351IndexEntry *si5351NearestIndexed(const Si5351Index &index, uint64_t milliHz) {
+    uint64_t count = index.header->count;
+    if (count == 0) {
+        return nullptr;
+    }
+
+    // First entry not below milliHz
+    uint64_t low = 0;
+    uint64_t high = count;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        if (index.entries[middle].milliHz < milliHz) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == count) {
+        return &index.entries[count - 1];
+    }
+    if (low > 0 && milliHz - index.entries[low - 1].milliHz < index.entries[low].milliHz - milliHz) {
+        return &index.entries[low - 1];
+    }
+    return &index.entries[low];
+}
+
+int si5351LookupFrequency(const Si5351Index *index, uint64_t outputMilliHz, double tolerancePpb, Si5351Solution *solution,
+                          bool *indexed) {
+    const Si5351IndexEntry *entry = index != nullptr ? si5351NearestIndexed(*index, outputMilliHz) : nullptr;
+    double errorPpb = entry != nullptr ? ((double)entry->milliHz - (double)outputMilliHz) / outputMilliHz * 1e9 : 0;
+
+    *indexed = entry != nullptr && fabs(errorPpb) <= tolerancePpb;
+    if (!*indexed) {
+        return si5351SolveFrequency(outputMilliHz, SI5351_XTAL_FREQUENCY, 0, solution);
+    }
+
+    // The dividers, read back from P1/P2/P3
+    Si5351Parameters feedback = si5351Unpack(entry->image.pll);
+    Si5351Parameters multiSynth = si5351Unpack(entry->image.multiSynth);
+    uint32_t whole = feedback.p1 + 512;
+    solution->image = entry->image;
+    solution->feedback.a = whole / 128;
+    solution->feedback.c = feedback.p3;
+    solution->feedback.b = (feedback.p2 + feedback.p3 * (whole % 128)) / 128;
+    solution->multiSynth = (multiSynth.p1 + 512) / 128;
+    solution->rDividerLog2 = (entry->image.multiSynth[2] >> 4) & 0x07;
+    solution->errorPpb = errorPpb;
+    return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * SI5351 frequency index
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   An offline table of solved register images, so that a slow board can
+ *   look a frequency up instead of running the solver. The generator
+ *   solves a geometric grid of frequencies over a band, one step per
+ *   resolution ppb, and writes one file:
+ *
+ *     header    magic "S5IX", version, entry size, resolution, crystal,
+ *               entry count and band
+ *     entries   achieved output frequency in millihertz and the CLK0
+ *               register image, sorted by frequency
+ *
+ *   All fields are little-endian. The lookup maps the file with mmap()
+ *   and finds the nearest achievable frequency by binary search; only if
+ *   that is further away than the tolerance is the full solver run.
+ */
+
+#ifndef SI5351_FREQUENCY_INDEX_H
+#define SI5351_FREQUENCY_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Si5351Solver.h"
+
+#define SI5351_INDEX_MAGIC "S5IX"
+#define SI5351_INDEX_VERSION 1
+#define SI5351_INDEX_RESOLUTION_PPB 1000
+
+struct Si5351IndexHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t entrySize;
+    uint32_t resolutionPpb;     // grid step
+    uint32_t xtalHz;
+    uint64_t count;
+    uint64_t lowMilliHz;        // band
+    uint64_t highMilliHz;
+};
+
+struct Si5351IndexEntry {
+    uint64_t milliHz;           // what the image produces
+    Si5351RegisterImage image;
+    uint8_t reserved[7];
+};
+
+/**
+ * An index file mapped into memory.
+ */
+struct Si5351Index {
+    const uint8_t *base;
+    size_t size;
+    const Si5351IndexHeader *header;
+    const Si5351IndexEntry *entries;
+};
+
+/**
+ * Solve a band of frequencies and write the index.
+ *
+ * @param path The file to create or replace (written to a temporary file and renamed).
+ * @param lowMilliHz The lowest frequency of the band.
+ * @param highMilliHz The highest frequency of the band.
+ * @param resolutionPpb The grid step.
+ * @return Number of entries written, or -1 on failure.
+ */
+int64_t si5351WriteIndex(const char *path, uint64_t lowMilliHz, uint64_t highMilliHz, uint32_t resolutionPpb);
+
+/**
+ * Map an index file and check its header and size.
+ *
+ * @return 0 on success, -1 if the file is missing or invalid.
+ */
+int si5351OpenIndex(const char *path, Si5351Index *index);
+
+void si5351CloseIndex(Si5351Index *index);
+
+/**
+ * Find the entry nearest to a frequency by binary search.
+ *
+ * @return The entry, or nullptr if the index is empty.
+ */
+const Si5351IndexEntry *si5351NearestIndexed(const Si5351Index &index, uint64_t milliHz);
+
+/**
+ * Solve a frequency from the index if an entry is within tolerance,
+ * otherwise with si5351SolveFrequency().
+ *
+ * @param index The mapped index, or nullptr to always solve.
+ * @param outputMilliHz The output frequency in millihertz.
+ * @param tolerancePpb How far the indexed frequency may be from the request.
+ * @param solution Receives the register image, its dividers and its error.
+ * @param indexed Receives whether the index answered.
+ * @return 0 on success, -1 if the frequency cannot be produced.
+ */
+int si5351LookupFrequency(const Si5351Index *index, uint64_t outputMilliHz, double tolerancePpb, Si5351Solution *solution,
+                          bool *indexed);
+
+#endif // SI5351_FREQUENCY_INDEX_H
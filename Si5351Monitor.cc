@@ -0,0 +1,204 @@
+/*
+ * SI5351 health monitor
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "Si5351Monitor.h"
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+    stopRequested = 1;
+}
+
+static uint64_t cpuNs() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return ((uint64_t)usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL +
+           ((uint64_t)usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL;
+}
+
+/**
+ * Print one event, stamped with the wall-clock time.
+ */
+static void report(const char *what, uint8_t bits, uint8_t status, uint8_t sticky) {
+    static const struct {
+        uint8_t bit;
+        const char *name;
+    } names[] = {
+        { SI5351_STATUS_SYS_INIT, "SYS_INIT" },
+        { SI5351_STATUS_LOL_A, "LOL_A" },
+        { SI5351_STATUS_LOL_B, "LOL_B" },
+        { SI5351_STATUS_LOS_XTAL, "LOS_XTAL" },
+    };
+    struct timespec now;
+    struct tm local;
+    char stamp[32];
+    clock_gettime(CLOCK_REALTIME, &now);
+    localtime_r(&now.tv_sec, &local);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+
+    printf("%s.%06ld %s:", stamp, now.tv_nsec / 1000, what);
+    for (const auto &name : names) {
+        if (bits & name.bit) {
+            printf(" %s", name.name);
+        }
+    }
+    printf(" (status %02Xh, sticky %02Xh)\n", status, sticky);
+    fflush(stdout);
+}
+
+/**
+ * Write the known-good map again from scratch: outputs disabled, every
+ * register, PLL reset, wait for lock, outputs enabled.
+ */
+static void reapply(Si5351Transport *transport, const Si5351RegisterMap &good, uint32_t lockDeadlineUs) {
+    static Si5351RegisterMap unknown;
+    Si5351Lock lock = {};
+    Si5351Update update;
+
+    memset(&unknown, 0, sizeof(unknown));
+    lock.deadlineUs = lockDeadlineUs;
+    if (si5351UpdateRegisters(transport, &unknown, good, &lock, &update) == -1) {
+        if (lock.timedOut) {
+            printf("  Reapplied, PLL not locked after %u us (status %02Xh), outputs left disabled\n", lock.lockUs, lock.status);
+        } else {
+            printf("  Reapply failed: register write error\n");
+        }
+    } else if (lock.locked) {
+        printf("  Reapplied %d registers, locked after %u us\n", update.written, lock.lockUs);
+    } else {
+        printf("  Reapplied %d registers\n", update.written);
+    }
+    fflush(stdout);
+}
+
+int si5351Monitor(Si5351Transport *transport, const Si5351RegisterMap &good, const Si5351MonitorOptions &options,
+                  Si5351MonitorStats *stats) {
+    static const uint8_t clearSticky[1] = { 0x00 };
+    const RegisterBlock clear = { SI5351_REGISTER_1_INTERRUPT_STATUS_STICKY, 1, clearSticky };
+    uint8_t mask = si5351LockMask(good) | SI5351_STATUS_LOS_XTAL;
+    uint32_t intervalMs = options.minIntervalMs;
+    uint8_t last = 0;           // watched bits at the previous poll
+    uint64_t faultNs = 0;       // since when a fault has lasted (or was last reapplied), 0 = healthy
+    bool first = true;
+    bool restarted = false;
+    bool busDown = false;
+
+    // What a poll and a clear put on the wire, for the load figures
+    uint8_t bytes[2] = {};
+    struct i2c_msg poll[2] = { { 0, 0, 1, bytes }, { 0, I2C_M_RD, 2, bytes } };
+    struct i2c_msg clearing[1] = { { 0, 0, 2, bytes } };
+    uint64_t pollBits = si5351WireBits(poll, 2);
+    uint64_t clearBits = si5351WireBits(clearing, 1);
+
+    memset(stats, 0, sizeof(*stats));
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+    uint64_t startNs = monotonicNs();
+    uint64_t startCpuNs = cpuNs();
+    printf("Monitoring status bits %02Xh every %u-%u ms%s.\n", mask, options.minIntervalMs, options.maxIntervalMs,
+           options.reapply ? ", reapplying the configuration on a fault" : "");
+    fflush(stdout);
+
+    while (!stopRequested) {
+        uint64_t pollNs = monotonicNs();
+        uint8_t registers[2];
+
+        // Registers 0 and 1 in one combined transfer
+        if (transport->readBlock(SI5351_REGISTER_0_DEVICE_STATUS, registers, 2) == -1) {
+            stats->busErrors++;
+            if (!busDown) {
+                report("bus error", 0, 0, 0);
+            }
+            busDown = true;
+            intervalMs = options.minIntervalMs;
+        } else {
+            stats->polls++;
+            stats->wireBits += pollBits;
+            busDown = false;
+            uint8_t status = registers[0] & mask;
+            uint8_t sticky = registers[1] & mask;
+
+            // Bits latched since the last poll but gone again; the first
+            // poll's latch holds the power-on SYS_INIT and is not news
+            uint8_t glitch = first ? 0 : sticky & ~status & ~last;
+            if (first) {
+                report(status == 0 ? "healthy" : "unhealthy at start", status, registers[0], registers[1]);
+            } else if (status != last) {
+                stats->events++;
+                if (status & ~last) {
+                    report("raised", status & ~last, registers[0], registers[1]);
+                }
+                if (last & ~status) {
+                    report("cleared", last & ~status, registers[0], registers[1]);
+                }
+            }
+            if (glitch != 0) {
+                stats->events++;
+                stats->glitches++;
+                report("glitch", glitch, registers[0], registers[1]);
+            }
+
+            // Latched bits that no longer hold are cleared, so a healthy
+            // chip is only ever read
+            if ((sticky & ~status) != 0) {
+                stats->wireBits += clearBits;
+                if (transport->writeBlocks(&clear, 1) == -1) {
+                    stats->busErrors++;
+                }
+            }
+
+            // A restart leaves every register at its default
+            if ((status | glitch) & SI5351_STATUS_SYS_INIT) {
+                restarted = true;
+            }
+            if (status == 0) {
+                faultNs = 0;
+            } else if (faultNs == 0) {
+                faultNs = pollNs;
+            }
+            bool initializing = status & SI5351_STATUS_SYS_INIT;
+            bool lasting = status != 0 && pollNs - faultNs >= SI5351_MONITOR_REAPPLY_AFTER_MS * 1000000ULL;
+            if (options.reapply && !initializing && (restarted || lasting)) {
+                reapply(transport, good, options.lockDeadlineUs);
+                stats->reapplied++;
+                restarted = false;
+                faultNs = faultNs != 0 ? monotonicNs() : 0;
+
+                // The PLL reset latches LOL; that is ours, not news
+                if (transport->writeBlocks(&clear, 1) == -1) {
+                    stats->busErrors++;
+                }
+            }
+
+            // Back off only while nothing happens
+            if (first || status != last || glitch != 0 || status != 0) {
+                intervalMs = options.minIntervalMs;
+            } else {
+                intervalMs = intervalMs * 2 > options.maxIntervalMs ? options.maxIntervalMs : intervalMs * 2;
+            }
+            last = status;
+            first = false;
+        }
+
+        // A signal ends the sleep early: either a stop or a reason to look now
+        uint64_t wake = pollNs + intervalMs * 1000000ULL;
+        struct timespec until;
+        until.tv_sec = wake / 1000000000ULL;
+        until.tv_nsec = wake % 1000000000ULL;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr);
+    }
+
+    stats->elapsedNs = monotonicNs() - startNs;
+    stats->cpuNs = cpuNs() - startCpuNs;
+    return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * SI5351 health monitor
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Watches a configured chip for loss of lock, loss of the crystal and
+ *   restarts. Each poll reads the status register (0) and the sticky
+ *   interrupt register (1) with one 2-byte combined write/read transfer,
+ *   so an event that came and went between two polls is still seen. The
+ *   interval doubles from the minimum to the maximum while the chip is
+ *   healthy and drops back to the minimum on any event; the sticky bits
+ *   are cleared only after an event, so a healthy chip costs one read per
+ *   maximum interval and nothing else.
+ *
+ *   Every change is printed with its wall-clock time. With reapply set,
+ *   the last known-good register map is written again, with a PLL reset
+ *   and a wait for lock, once SYS_INIT has cleared after a restart or
+ *   once loss of lock or of the crystal has lasted
+ *   SI5351_MONITOR_REAPPLY_AFTER_MS.
+ */
+
+#ifndef SI5351_MONITOR_H
+#define SI5351_MONITOR_H
+
+#include <stdint.h>
+
+#include "Si5351Configuration.h"
+#include "Si5351Transport.h"
+
+#define SI5351_MONITOR_INTERVAL_MIN_MS 10
+#define SI5351_MONITOR_INTERVAL_MAX_MS 1000
+#define SI5351_MONITOR_REAPPLY_AFTER_MS 100
+
+struct Si5351MonitorOptions {
+    uint32_t minIntervalMs;     // poll interval after an event
+    uint32_t maxIntervalMs;     // poll interval of a healthy chip
+    bool reapply;               // rewrite the known-good map on a fault
+    uint32_t lockDeadlineUs;    // wait for lock after a rewrite, 0 = do not wait
+};
+
+/**
+ * What a monitor session saw and cost.
+ */
+struct Si5351MonitorStats {
+    uint32_t polls;
+    uint32_t events;            // changes of the watched status bits, glitches included
+    uint32_t glitches;          // events seen only in the sticky register
+    uint32_t busErrors;
+    uint32_t reapplied;
+    uint64_t wireBits;          // of the polls and sticky clears
+    uint64_t elapsedNs;
+    uint64_t cpuNs;             // user and system time of the process
+};
+
+/**
+ * Monitor the chip until SIGINT or SIGTERM.
+ *
+ * @param transport The bus to the chip, kept open while monitoring.
+ * @param good The register map the chip should hold.
+ * @param options Poll intervals and what to do on a fault.
+ * @param stats Receives the totals of the session.
+ * @return 0 on clean shutdown.
+ */
+int si5351Monitor(Si5351Transport *transport, const Si5351RegisterMap &good, const Si5351MonitorOptions &options,
+                  Si5351MonitorStats *stats);
+
+#endif // SI5351_MONITOR_H
@@ -0,0 +1,154 @@
+/*
+ * SI5351 dual-PLL ping-pong switching
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "Si5351PingPong.h"
+
+/**
+ * Solve one PLL's frequency into pingPong.
+ *
+ * @param multiSynth The MultiSynth0 divider to use, 0 = any.
+ */
+static int solvePll(uint64_t outputMilliHz, uint32_t multiSynth, int pll, Si5351PingPong *pingPong) {
+    Si5351Solution solution;
+    if (si5351SolveFrequency(outputMilliHz, SI5351_XTAL_FREQUENCY, multiSynth, &solution) == -1) {
+        return -1;
+    }
+    pingPong->outputMilliHz[pll] = outputMilliHz;
+    pingPong->divider[pll] = solution.multiSynth;
+    pingPong->errorPpb[pll] = solution.errorPpb;
+    memcpy(pingPong->pll[pll], solution.image.pll, sizeof(solution.image.pll));
+    memcpy(pingPong->multiSynth[pll], solution.image.multiSynth, sizeof(solution.image.multiSynth));
+    pingPong->clockControl[pll] = solution.image.clockControl;
+    return 0;
+}
+
+static bool shared(const Si5351PingPong &pingPong) {
+    return memcmp(pingPong.multiSynth[0], pingPong.multiSynth[1], sizeof(pingPong.multiSynth[0])) == 0;
+}
+
+int si5351PingPongSolve(const uint64_t outputMilliHz[2], const uint32_t multiSynth[2], Si5351PingPong *pingPong) {
+    memset(pingPong, 0, sizeof(*pingPong));
+    if (solvePll(outputMilliHz[0], multiSynth[0], 0, pingPong) == -1 || solvePll(outputMilliHz[1], multiSynth[1], 1, pingPong) == -1) {
+        return -1;
+    }
+
+    // One divider for both makes a switch a single register write: try A's, then B's
+    Si5351PingPong candidate = *pingPong;
+    if (!shared(candidate) && solvePll(outputMilliHz[1], pingPong->divider[0], 1, &candidate) == 0 && shared(candidate)) {
+        *pingPong = candidate;
+    }
+    candidate = *pingPong;
+    if (!shared(candidate) && solvePll(outputMilliHz[0], pingPong->divider[1], 0, &candidate) == 0 && shared(candidate)) {
+        *pingPong = candidate;
+    }
+    return 0;
+}
+
+int si5351PingPongSetup(Si5351Transport *transport, const Si5351PingPong &pingPong, Si5351Lock *lock) {
+    static const uint8_t disableOutputs[1] = { 0xFF };
+    static const uint8_t enableOutputs[1] = { 0x00 };
+    static const uint8_t pllReset[1] = { SI5351_PLL_RESET_A | SI5351_PLL_RESET_B };
+
+    // CLK0 from the active PLL, CLK1-CLK7 powered down, disable state low
+    uint8_t control[10] = { (uint8_t)(pingPong.clockControl[pingPong.active] | (pingPong.active ? SI5351_CLK_CONTROL_PLL_B : 0)),
+                            0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00, 0x00 };
+    const RegisterBlock blocks[] = {
+        { SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 1, disableOutputs, SI5351_PHASE_DISABLE },
+        { SI5351_REGISTER_16_CLK0_CONTROL, 10, control, SI5351_PHASE_CLOCK_CONTROL },
+        { SI5351_REGISTER_26_PLL_A_REG0, 8, pingPong.pll[0], SI5351_PHASE_PLL },
+        { SI5351_REGISTER_34_PLL_B_REG0, 8, pingPong.pll[1], SI5351_PHASE_PLL },
+        { SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1, 8, pingPong.multiSynth[pingPong.active], SI5351_PHASE_MULTISYNTH },
+        { SI5351_REGISTER_177_PLL_RESET, 1, pllReset, SI5351_PHASE_RESET },
+        { SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 1, enableOutputs, SI5351_PHASE_ENABLE },
+    };
+    const int count = sizeof(blocks) / sizeof(blocks[0]);
+
+    // Registers 16-49 go out as one message; both PLLs must lock before the enable
+    if (lock == nullptr || lock->deadlineUs == 0) {
+        return transport->writeBlocks(blocks, count) == -1 ? -1 : 0;
+    }
+    if (transport->writeBlocks(blocks, count - 1) == -1 ||
+        si5351WaitForLock(transport, SI5351_STATUS_SYS_INIT | SI5351_STATUS_LOL_A | SI5351_STATUS_LOL_B, monotonicNs(), lock) == -1) {
+        return -1;
+    }
+    return transport->writeBlocks(blocks + count - 1, 1) == -1 ? -1 : 0;
+}
+
+int si5351PingPongSelect(Si5351Transport *transport, Si5351PingPong *pingPong, uint64_t outputMilliHz, uint32_t lockDeadlineUs,
+                         Si5351Switch *result) {
+    int active = pingPong->active;
+    int idle = 1 - active;
+
+    memset(result, 0, sizeof(*result));
+    if (outputMilliHz == pingPong->outputMilliHz[active]) {
+        return 0;
+    }
+
+    if (outputMilliHz != pingPong->outputMilliHz[idle]) {
+        // Load the idle PLL, with the active divider if its VCO can reach it
+        Si5351PingPong next = *pingPong;
+        if ((solvePll(outputMilliHz, pingPong->divider[active], idle, &next) == -1 || !shared(next)) &&
+            solvePll(outputMilliHz, 0, idle, &next) == -1) {
+            return -1;
+        }
+        const uint8_t reset[1] = { (uint8_t)(idle ? SI5351_PLL_RESET_B : SI5351_PLL_RESET_A) };
+        const RegisterBlock load[] = {
+            { (uint8_t)(idle ? SI5351_REGISTER_34_PLL_B_REG0 : SI5351_REGISTER_26_PLL_A_REG0), 8, next.pll[idle], SI5351_PHASE_PLL },
+            { SI5351_REGISTER_177_PLL_RESET, 1, reset, SI5351_PHASE_RESET },
+        };
+        if (transport->writeBlocks(load, 2) == -1) {
+            return -1;
+        }
+        *pingPong = next;
+        result->loaded = true;
+
+        // CLK0 keeps running from the active PLL meanwhile
+        if (lockDeadlineUs > 0) {
+            Si5351Lock lock = {};
+            lock.deadlineUs = lockDeadlineUs;
+            int locked = si5351WaitForLock(transport, idle ? SI5351_STATUS_LOL_B : SI5351_STATUS_LOL_A, monotonicNs(), &lock);
+            result->lockUs = lock.lockUs;
+            if (locked == -1) {
+                return -1;
+            }
+        }
+    }
+
+    // MS_SRC, then only the MultiSynth0 bytes that differ, in one transfer
+    const uint8_t control[1] = { (uint8_t)(pingPong->clockControl[idle] | (idle ? SI5351_CLK_CONTROL_PLL_B : 0)) };
+    RegisterBlock blocks[2] = { { SI5351_REGISTER_16_CLK0_CONTROL, 1, control, SI5351_PHASE_CLOCK_CONTROL } };
+    int count = 1;
+    int first = 0;
+    int last = 7;
+    while (first < 8 && pingPong->multiSynth[idle][first] == pingPong->multiSynth[active][first]) {
+        first++;
+    }
+    while (last > first && pingPong->multiSynth[idle][last] == pingPong->multiSynth[active][last]) {
+        last--;
+    }
+    result->registers = 1;
+    result->wireBits = 1 + 9 + 9 + 9 + 1;
+    if (first < 8) {
+        int length = last - first + 1;
+        blocks[count++] = RegisterBlock{ (uint8_t)(SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1 + first), (uint8_t)length,
+                                         pingPong->multiSynth[idle] + first, SI5351_PHASE_MULTISYNTH };
+        result->registers += length;
+        result->transitionBits = 1 + 9 + 9 + 9 * length;
+        result->wireBits += result->transitionBits;
+    }
+
+    uint64_t start = monotonicNs();
+    if (transport->writeBlocks(blocks, count) == -1) {
+        return -1;
+    }
+    result->switchNs = monotonicNs() - start;
+    pingPong->active = idle;
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * SI5351 dual-PLL ping-pong switching
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Switching CLK0 between two frequencies (PAL and NTSC) without a PLL
+ *   reset. Each frequency gets a PLL of its own: the one CLK0 runs from,
+ *   and the other kept programmed and locked. A switch only selects the
+ *   other PLL through MS0_SRC in the CLK0 control register (16), so the
+ *   output is never disabled and nothing has to relock.
+ *
+ *   Both frequencies are solved for the same integer MultiSynth0
+ *   divider where both VCOs allow it, so a switch is a single register
+ *   write. Otherwise the changed MultiSynth0 bytes follow in the same
+ *   transfer, and CLK0 runs at an intermediate frequency until they
+ *   are written.
+ *
+ *   Selecting a third frequency loads it into the idle PLL first and
+ *   resets only that PLL (PLLA_RST or PLLB_RST); CLK0 keeps running from
+ *   the active PLL until the idle one has locked.
+ */
+
+#ifndef SI5351_PING_PONG_H
+#define SI5351_PING_PONG_H
+
+#include <stdint.h>
+
+#include "Si5351Configuration.h"
+#include "Si5351Transport.h"
+
+struct Si5351PingPong {
+    uint64_t outputMilliHz[2];  // per PLL, A first
+    uint32_t divider[2];        // integer MultiSynth0 divider for each
+    double errorPpb[2];
+    uint8_t pll[2][8];          // registers 26-33 and 34-41
+    uint8_t multiSynth[2][8];   // MultiSynth0 (42-49) for each
+    uint8_t clockControl[2];    // register 16 without MS_SRC, for each (MS0_INT follows the divider)
+    int active;                 // PLL that drives CLK0, 0 = A
+};
+
+/**
+ * What one switch wrote and how long it took.
+ */
+struct Si5351Switch {
+    bool loaded;                // the idle PLL was reprogrammed and reset first
+    uint32_t lockUs;            // its lock time
+    int registers;              // written by the switching transfer
+    uint32_t wireBits;          // of the switching transfer
+    uint32_t transitionBits;    // from MS_SRC to the last MultiSynth0 byte, 0 with a shared divider
+    uint64_t switchNs;          // wall-clock time of the switching transfer
+};
+
+/**
+ * Solve two frequencies for PLL A and PLL B, with a shared MultiSynth0
+ * divider if both VCOs can reach it.
+ *
+ * @param outputMilliHz The frequencies, for PLL A and PLL B.
+ * @param multiSynth Preferred MultiSynth0 divider for each (e.g. a preset's), 0 = any.
+ * @param pingPong Receives the register values; PLL A is active.
+ * @return 0 on success, -1 if a frequency cannot be produced.
+ */
+int si5351PingPongSolve(const uint64_t outputMilliHz[2], const uint32_t multiSynth[2], Si5351PingPong *pingPong);
+
+/**
+ * Program both PLLs, reset them, wait for both to lock and enable CLK0
+ * from the active one.
+ *
+ * @return 0 on success, -1 on bus failure or lock timeout.
+ */
+int si5351PingPongSetup(Si5351Transport *transport, const Si5351PingPong &pingPong, Si5351Lock *lock);
+
+/**
+ * Switch CLK0 to a frequency: select the idle PLL if it already holds
+ * it, otherwise load the idle PLL, wait for it to lock, then select it.
+ *
+ * @param lockDeadlineUs How long to wait for the idle PLL to lock.
+ * @param result Receives what was written.
+ * @return 0 on success, -1 on bus failure, lock timeout or a frequency out of range.
+ */
+int si5351PingPongSelect(Si5351Transport *transport, Si5351PingPong *pingPong, uint64_t outputMilliHz, uint32_t lockDeadlineUs,
+                         Si5351Switch *result);
+
+#endif // SI5351_PING_PONG_H
@@ -0,0 +1,313 @@
+/*
+ * SI5351 multi-output frequency planner
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <string.h>
+
+#include "Si5351Planner.h"
+
+#define SI5351_R_DIVIDER_LOG2_MAX 7
+#define SI5351_MULTISYNTH67_MIN 6
+#define SI5351_MULTISYNTH67_MAX 254
+
+// Errors below this are treated as equal when comparing plans
+#define SI5351_PLAN_ERROR_FLOOR_PPB 0.001
+
+/**
+ * Dividers for one output under a given VCO.
+ */
+struct OutputChoice {
+    Si5351Divider multiSynth;
+    uint8_t rDividerLog2;
+    double errorPpb;
+};
+
+/**
+ * Best VCO for one group of outputs sharing a PLL.
+ */
+struct GroupPlan {
+    bool valid;
+    uint64_t vcoMilliHz;
+    Si5351Divider feedback;
+    OutputChoice outputs[SI5351_PLAN_MAX_OUTPUTS];
+    double worstErrorPpb;
+    int fractional;             // fractional MultiSynth and feedback dividers
+};
+
+static double magnitude(double x) {
+    return x < 0 ? -x : x;
+}
+
+static double relativeError(Si5351Divider divider, uint64_t numerator, uint64_t denominator) {
+    double actual = divider.a + (double)divider.b / divider.c;
+    double ideal = (double)numerator / denominator;
+    return (actual - ideal) / ideal;
+}
+
+/**
+ * Choose the MultiSynth and R dividers for one output.
+ *
+ * @return false if the output cannot be derived from this VCO.
+ */
+static bool chooseOutput(uint64_t vcoMilliHz, uint64_t outputMilliHz, int clk, double feedbackError, OutputChoice *choice) {
+    uint8_t r = 0;
+    while (vcoMilliHz / (outputMilliHz << r) > SI5351_MULTISYNTH_MAX) {
+        if (++r > SI5351_R_DIVIDER_LOG2_MAX) {
+            return false;
+        }
+    }
+    uint64_t divided = outputMilliHz << r;
+
+    Si5351Divider divider;
+    if (clk >= 6) {
+        // Even integers only
+        uint64_t even = (vcoMilliHz + divided) / (2 * divided) * 2;
+        if (even < SI5351_MULTISYNTH67_MIN || even > SI5351_MULTISYNTH67_MAX) {
+            return false;
+        }
+        divider = Si5351Divider{ (uint32_t)even, 0, 1 };
+    } else {
+        divider = si5351Approximate(vcoMilliHz, divided);
+        if (divider.a < SI5351_MULTISYNTH_MIN || divider.a > SI5351_MULTISYNTH_MAX) {
+            return false;
+        }
+    }
+
+    choice->multiSynth = divider;
+    choice->rDividerLog2 = r;
+    // f = vco * (1 + e_fb) / (ms * (1 + e_ms))
+    choice->errorPpb = ((1 + feedbackError) / (1 + relativeError(divider, vcoMilliHz, divided)) - 1) * 1e9;
+    return true;
+}
+
+/**
+ * Evaluate every output of a group under one VCO.
+ */
+static bool evaluateGroup(const uint64_t *outputMilliHz, uint32_t members, uint64_t vcoMilliHz, uint64_t xtalHz, GroupPlan *plan) {
+    plan->vcoMilliHz = vcoMilliHz;
+    plan->feedback = si5351FeedbackDivider(vcoMilliHz, xtalHz);
+    plan->worstErrorPpb = 0;
+    plan->fractional = plan->feedback.b != 0;
+
+    double feedbackError = relativeError(plan->feedback, vcoMilliHz, xtalHz * 1000);
+    for (int i = 0; i < SI5351_PLAN_MAX_OUTPUTS; i++) {
+        if (!(members & (1 << i))) {
+            continue;
+        }
+        if (!chooseOutput(vcoMilliHz, outputMilliHz[i], i, feedbackError, &plan->outputs[i])) {
+            return false;
+        }
+        double error = magnitude(plan->outputs[i].errorPpb);
+        if (error > plan->worstErrorPpb) {
+            plan->worstErrorPpb = error;
+        }
+        if (plan->outputs[i].multiSynth.b != 0 || (plan->outputs[i].multiSynth.a & 1)) {
+            plan->fractional++;
+        }
+    }
+    return true;
+}
+
+/**
+ * Order plans by worst error, then fractional divider count, then a VCO
+ * close to 700 MHz.
+ */
+static bool better(double error, int fractional, uint64_t vcoMilliHz, double bestError, int bestFractional, uint64_t bestVcoMilliHz) {
+    if (error < SI5351_PLAN_ERROR_FLOOR_PPB) {
+        error = 0;
+    }
+    if (bestError < SI5351_PLAN_ERROR_FLOOR_PPB) {
+        bestError = 0;
+    }
+    if (error != bestError) {
+        return error < bestError;
+    }
+    if (fractional != bestFractional) {
+        return fractional < bestFractional;
+    }
+    uint64_t center = 700000000000ULL;
+    uint64_t distance = vcoMilliHz > center ? vcoMilliHz - center : center - vcoMilliHz;
+    uint64_t bestDistance = bestVcoMilliHz > center ? bestVcoMilliHz - center : center - bestVcoMilliHz;
+    return distance < bestDistance;
+}
+
+/**
+ * Try every VCO that gives one of the members an even integer divider.
+ */
+static void planGroup(const uint64_t *outputMilliHz, uint32_t members, uint64_t xtalHz, GroupPlan *best) {
+    best->valid = false;
+
+    for (int anchor = 0; anchor < SI5351_PLAN_MAX_OUTPUTS; anchor++) {
+        if (!(members & (1 << anchor))) {
+            continue;
+        }
+
+        uint8_t r = 0;
+        while ((outputMilliHz[anchor] << r) * SI5351_MULTISYNTH_MAX < SI5351_VCO_MIN * 1000 && r < SI5351_R_DIVIDER_LOG2_MAX) {
+            r++;
+        }
+        uint64_t divided = outputMilliHz[anchor] << r;
+        uint64_t lowest = (SI5351_VCO_MIN * 1000 + divided - 1) / divided;
+        uint64_t highest = SI5351_VCO_MAX * 1000 / divided;
+
+        for (uint64_t m = (lowest + 1) & ~1ULL; m <= highest; m += 2) {
+            GroupPlan candidate;
+            if (m < SI5351_MULTISYNTH_MIN || m > SI5351_MULTISYNTH_MAX ||
+                !evaluateGroup(outputMilliHz, members, divided * m, xtalHz, &candidate)) {
+                continue;
+            }
+            if (!best->valid || better(candidate.worstErrorPpb, candidate.fractional, candidate.vcoMilliHz,
+                                       best->worstErrorPpb, best->fractional, best->vcoMilliHz)) {
+                *best = candidate;
+                best->valid = true;
+            }
+        }
+    }
+}
+
+/**
+ * Fill in the register image of a finished plan.
+ */
+static void buildRegisters(Si5351Plan *plan) {
+    uint8_t *registers = plan->registers;
+    memset(registers, 0, sizeof(plan->registers));
+
+    // CLK control, powered down unless used
+    for (int i = 0; i < 8; i++) {
+        registers[SI5351_REGISTER_16_CLK0_CONTROL + i - SI5351_PLAN_FIRST_REGISTER] = 0x80;
+    }
+    plan->outputEnable = 0xFF;
+
+    for (int pll = 0; pll < 2; pll++) {
+        if (plan->pllUsed & (1 << pll)) {
+            si5351Pack(si5351Encode(plan->feedback[pll]), 0,
+                       registers + SI5351_REGISTER_26_PLL_A_REG0 + 8 * pll - SI5351_PLAN_FIRST_REGISTER);
+        }
+    }
+
+    for (int i = 0; i < plan->outputCount; i++) {
+        const Si5351PlanOutput &output = plan->outputs[i];
+        bool integer = output.multiSynth.b == 0 && (output.multiSynth.a & 1) == 0;
+        uint8_t control = SI5351_CLK_CONTROL_MULTISYNTH_8MA | (output.pll ? 0x20 : 0x00);
+
+        if (i < 6) {
+            if (integer) {
+                control |= SI5351_CLK_CONTROL_INTEGER_MODE;
+            }
+            si5351Pack(si5351Encode(output.multiSynth), (uint8_t)(output.rDividerLog2 << 4),
+                       registers + SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1 + 8 * i - SI5351_PLAN_FIRST_REGISTER);
+        } else {
+            registers[SI5351_REGISTER_90_MULTISYNTH6_PARAMETERS + (i - 6) - SI5351_PLAN_FIRST_REGISTER] = (uint8_t)output.multiSynth.a;
+            registers[SI5351_REGISTER_92_CLK6_7_OUTPUT_DIVIDER - SI5351_PLAN_FIRST_REGISTER] |= output.rDividerLog2 << (i == 6 ? 0 : 4);
+        }
+        registers[SI5351_REGISTER_16_CLK0_CONTROL + i - SI5351_PLAN_FIRST_REGISTER] = control;
+        plan->outputEnable &= ~(1 << i);
+    }
+
+    // FBA_INT and FBB_INT live in the CLK6 and CLK7 control registers
+    for (int pll = 0; pll < 2; pll++) {
+        if ((plan->pllUsed & (1 << pll)) && plan->feedback[pll].b == 0) {
+            registers[SI5351_REGISTER_22_CLK6_CONTROL + pll - SI5351_PLAN_FIRST_REGISTER] |= 0x40;
+        }
+    }
+}
+
+int si5351Plan(const uint64_t *outputMilliHz, int count, uint64_t xtalHz, Si5351Plan *plan) {
+    static GroupPlan groups[1 << SI5351_PLAN_MAX_OUTPUTS];
+    static bool planned[1 << SI5351_PLAN_MAX_OUTPUTS];
+
+    if (count < 1 || count > SI5351_PLAN_MAX_OUTPUTS) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (outputMilliHz[i] == 0) {
+            return -1;
+        }
+    }
+    memset(planned, 0, sizeof(planned));
+
+    uint32_t all = (1u << count) - 1;
+    bool found = false;
+    double bestError = 0;
+    int bestFractional = 0;
+    int bestPlls = 0;
+    uint32_t bestB = 0;
+
+    // CLK0 always stays on PLL A; PLL B takes any subset of the others
+    for (uint32_t b = 0; b < all; b += 2) {
+        uint32_t a = all & ~b;
+        uint32_t groupMasks[2] = { a, b };
+        double error = 0;
+        int fractional = 0;
+        bool valid = true;
+
+        for (uint32_t mask : groupMasks) {
+            if (mask == 0) {
+                continue;
+            }
+            if (!planned[mask]) {
+                planGroup(outputMilliHz, mask, xtalHz, &groups[mask]);
+                planned[mask] = true;
+            }
+            if (!groups[mask].valid) {
+                valid = false;
+                break;
+            }
+            if (groups[mask].worstErrorPpb > error) {
+                error = groups[mask].worstErrorPpb;
+            }
+            fractional += groups[mask].fractional;
+        }
+        if (!valid) {
+            continue;
+        }
+
+        int plls = b == 0 ? 1 : 2;
+        if (error < SI5351_PLAN_ERROR_FLOOR_PPB) {
+            error = 0;
+        }
+        if (!found || error < bestError || (error == bestError && (fractional < bestFractional ||
+                                                                   (fractional == bestFractional && plls < bestPlls)))) {
+            found = true;
+            bestError = error;
+            bestFractional = fractional;
+            bestPlls = plls;
+            bestB = b;
+        }
+    }
+
+    if (!found) {
+        return -1;
+    }
+
+    memset(plan, 0, sizeof(*plan));
+    plan->outputCount = count;
+    uint32_t groupMasks[2] = { all & ~bestB, bestB };
+    for (int pll = 0; pll < 2; pll++) {
+        const GroupPlan &group = groups[groupMasks[pll]];
+        if (groupMasks[pll] == 0) {
+            continue;
+        }
+        plan->pllUsed |= 1 << pll;
+        plan->vcoMilliHz[pll] = group.vcoMilliHz;
+        plan->feedback[pll] = group.feedback;
+        for (int i = 0; i < count; i++) {
+            if (groupMasks[pll] & (1 << i)) {
+                plan->outputs[i].outputMilliHz = outputMilliHz[i];
+                plan->outputs[i].pll = pll;
+                plan->outputs[i].multiSynth = group.outputs[i].multiSynth;
+                plan->outputs[i].rDividerLog2 = group.outputs[i].rDividerLog2;
+                plan->outputs[i].errorPpb = group.outputs[i].errorPpb;
+                if (magnitude(group.outputs[i].errorPpb) > plan->worstErrorPpb) {
+                    plan->worstErrorPpb = magnitude(group.outputs[i].errorPpb);
+                }
+            }
+        }
+    }
+
+    buildRegisters(plan);
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*
+ * SI5351 multi-output frequency planner
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Produces several clocks at once: output i of the request becomes CLKi.
+ *   Every split of the outputs between PLL A and PLL B is tried; for each
+ *   group the VCO is chosen so that one output gets an even integer
+ *   MultiSynth divider and the others are approximated with fractional
+ *   dividers. The plan with the lowest worst-case error wins, preferring
+ *   fewer fractional dividers and a single PLL when errors are equal.
+ *
+ *   CLK6 and CLK7 only have even integer dividers (6..254), so outputs
+ *   placed there are exact only when the VCO is an even multiple.
+ */
+
+#ifndef SI5351_PLANNER_H
+#define SI5351_PLANNER_H
+
+#include <stdint.h>
+
+#include "Si5351Registers.h"
+#include "Si5351Solver.h"
+
+#define SI5351_PLAN_MAX_OUTPUTS 8
+#define SI5351_PLAN_FIRST_REGISTER SI5351_REGISTER_16_CLK0_CONTROL
+#define SI5351_PLAN_LAST_REGISTER SI5351_REGISTER_92_CLK6_7_OUTPUT_DIVIDER
+#define SI5351_PLAN_REGISTER_COUNT (SI5351_PLAN_LAST_REGISTER - SI5351_PLAN_FIRST_REGISTER + 1)
+
+struct Si5351PlanOutput {
+    uint64_t outputMilliHz;
+    uint8_t pll;                // 0 = PLL A, 1 = PLL B
+    Si5351Divider multiSynth;
+    uint8_t rDividerLog2;
+    double errorPpb;            // signed, (actual - target) / target
+};
+
+struct Si5351Plan {
+    int outputCount;
+    uint8_t pllUsed;            // bit 0 = PLL A, bit 1 = PLL B
+    uint64_t vcoMilliHz[2];
+    Si5351Divider feedback[2];
+    Si5351PlanOutput outputs[SI5351_PLAN_MAX_OUTPUTS];
+    double worstErrorPpb;
+    uint8_t outputEnable;       // register 3, unused outputs disabled
+
+    // Registers 16-92: CLK control, disable state, PLL A/B, MultiSynth0-7
+    uint8_t registers[SI5351_PLAN_REGISTER_COUNT];
+};
+
+/**
+ * Plan up to eight outputs over both PLLs.
+ *
+ * @param outputMilliHz The output frequencies in millihertz; entry i drives CLKi.
+ * @param count The number of outputs (1..8).
+ * @param xtalHz The reference frequency in hertz.
+ * @param plan Receives the dividers, errors and register image.
+ * @return 0 on success, -1 if some output cannot be produced.
+ */
+int si5351Plan(const uint64_t *outputMilliHz, int count, uint64_t xtalHz, Si5351Plan *plan);
+
+#endif // SI5351_PLANNER_H
@@ -0,0 +1,343 @@
+/*
+ * SI5351 binary preset store
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Si5351PresetStore.h"
+
+// Enough for every register in one run per register, the worst case
+#define STORE_MAX_RUN_BYTES (3 * 256)
+
+/**
+ * Continue a CRC-32 (IEEE 802.3). Start with 0xFFFFFFFF and invert the result.
+ */
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+int si5351ImportCbp(const char *path, Si5351RegisterMap *map) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        perror("Failed to open the register map");
+        return -1;
+    }
+
+    memset(map, 0, sizeof(*map));
+    int count = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        unsigned int address, value;
+        char suffix = 0;
+        const char *brace = strchr(line, '{');
+
+        if (brace != nullptr && sscanf(brace, "{ %i , %i }", &address, &value) == 2) {
+            // C header: { 0x001A, 0x00 },
+        } else if (sscanf(line, " %u , %x%c", &address, &value, &suffix) >= 2 && (suffix == 'h' || suffix == 'H')) {
+            // CSV: 26,00h
+        } else {
+            continue;
+        }
+        if (address > 255 || value > 255) {
+            fprintf(stderr, "%s: register %u out of range\n", path, address);
+            fclose(file);
+            return -1;
+        }
+        si5351MapSet(map, (uint8_t)address, (uint8_t)value);
+        count++;
+    }
+
+    fclose(file);
+    if (count == 0) {
+        fprintf(stderr, "%s: no registers found\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Encode the runs of a register map.
+ *
+ * @return Number of bytes written to out.
+ */
+static int encodeRuns(const Si5351RegisterMap &map, uint8_t *out, uint16_t *registerCount) {
+    int length = 0;
+    int runStart = -1;
+    *registerCount = 0;
+
+    for (int reg = 0; reg <= 256; reg++) {
+        bool defined = reg < 256 && si5351MapDefined(map, reg);
+        // The run length is one byte, so a run of all 256 registers is split
+        if (runStart >= 0 && (!defined || reg - runStart == 255)) {
+            out[length++] = (uint8_t)runStart;
+            out[length++] = (uint8_t)(reg - runStart);
+            memcpy(out + length, map.values + runStart, reg - runStart);
+            length += reg - runStart;
+            runStart = -1;
+        }
+        if (defined) {
+            if (runStart < 0) {
+                runStart = reg;
+            }
+            (*registerCount)++;
+        }
+    }
+    return length;
+}
+
+int si5351WriteStore(const char *path, const char *const *names, const Si5351RegisterMap *maps, int count) {
+    static uint8_t runs[SI5351_STORE_MAX_PRESETS][STORE_MAX_RUN_BYTES];
+    static Si5351StoreEntry entries[SI5351_STORE_MAX_PRESETS];
+    int order[SI5351_STORE_MAX_PRESETS];
+
+    if (count < 0 || count > SI5351_STORE_MAX_PRESETS) {
+        return -1;
+    }
+
+    // Index sorted by name for the binary search
+    for (int i = 0; i < count; i++) {
+        if (strlen(names[i]) >= SI5351_STORE_NAME_LENGTH) {
+            fprintf(stderr, "Preset name too long: %s\n", names[i]);
+            return -1;
+        }
+        int j = i;
+        while (j > 0 && strcmp(names[order[j - 1]], names[i]) > 0) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    Si5351StoreHeader header;
+    memcpy(header.magic, SI5351_STORE_MAGIC, sizeof(header.magic));
+    header.version = SI5351_STORE_VERSION;
+    header.presetCount = (uint16_t)count;
+
+    uint32_t offset = sizeof(header) + count * sizeof(Si5351StoreEntry);
+    for (int i = 0; i < count; i++) {
+        Si5351StoreEntry &entry = entries[i];
+        memset(&entry, 0, sizeof(entry));
+        strcpy(entry.name, names[order[i]]);
+        entry.offset = offset;
+        entry.length = (uint16_t)encodeRuns(maps[order[i]], runs[i], &entry.registerCount);
+        offset += entry.length;
+    }
+    header.size = offset;
+
+    uint32_t crc = crc32Update(0xFFFFFFFF, (const uint8_t *)entries, count * sizeof(Si5351StoreEntry));
+    for (int i = 0; i < count; i++) {
+        crc = crc32Update(crc, runs[i], entries[i].length);
+    }
+    header.checksum = ~crc;
+
+    char temporary[512];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    FILE *file = fopen(temporary, "wb");
+    if (file == nullptr) {
+        perror("Failed to create the preset file");
+        return -1;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   (count == 0 || fwrite(entries, sizeof(Si5351StoreEntry), count, file) == (size_t)count);
+    for (int i = 0; i < count && written; i++) {
+        written = fwrite(runs[i], 1, entries[i].length, file) == entries[i].length;
+    }
+    if (fclose(file) != 0 || !written || rename(temporary, path) != 0) {
+        perror("Failed to write the preset file");
+        unlink(temporary);
+        return -1;
+    }
+    return 0;
+}
+
+int si5351OpenStore(const char *path, Si5351Store *store) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open the preset file");
+        return -1;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) < 0 || (size_t)status.st_size < sizeof(Si5351StoreHeader)) {
+        fprintf(stderr, "%s: not a preset file\n", path);
+        close(fd);
+        return -1;
+    }
+    void *base = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Failed to map the preset file");
+        return -1;
+    }
+
+    store->base = (const uint8_t *)base;
+    store->size = status.st_size;
+    store->header = (const Si5351StoreHeader *)base;
+    store->entries = (const Si5351StoreEntry *)(store->base + sizeof(Si5351StoreHeader));
+
+    const Si5351StoreHeader &header = *store->header;
+    const char *problem = nullptr;
+    if (memcmp(header.magic, SI5351_STORE_MAGIC, sizeof(header.magic)) != 0) {
+        problem = "not a preset file";
+    } else if (header.version != SI5351_STORE_VERSION) {
+        problem = "unsupported preset file version";
+    } else if (header.size != store->size ||
+               sizeof(Si5351StoreHeader) + header.presetCount * sizeof(Si5351StoreEntry) > store->size) {
+        problem = "truncated preset file";
+    } else if (~crc32Update(0xFFFFFFFF, store->base + sizeof(header), store->size - sizeof(header)) != header.checksum) {
+        problem = "preset file checksum mismatch";
+    }
+    for (int i = 0; problem == nullptr && i < header.presetCount; i++) {
+        if (store->entries[i].offset + store->entries[i].length > store->size ||
+            store->entries[i].name[SI5351_STORE_NAME_LENGTH - 1] != '\0') {
+            problem = "corrupt preset index";
+        }
+    }
+    if (problem != nullptr) {
+        fprintf(stderr, "%s: %s\n", path, problem);
+        si5351CloseStore(store);
+        return -1;
+    }
+    return 0;
+}
+
+void si5351CloseStore(Si5351Store *store) {
+    if (store->base != nullptr) {
+        munmap((void *)store->base, store->size);
+        store->base = nullptr;
+    }
+}
+
+const Si5351StoreEntry *si5351FindStoredPreset(const Si5351Store &store, const char *name) {
+    int low = 0;
+    int high = store.header->presetCount - 1;
+
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        int order = strncmp(store.entries[middle].name, name, SI5351_STORE_NAME_LENGTH);
+        if (order == 0) {
+            return &store.entries[middle];
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Whether a stored register is written as part of the runs. The status
+ * registers are read-only and the output enable and PLL reset are written
+ * at their own point of the sequence.
+ */
+static bool streamed(int reg) {
+    return reg > SI5351_REGISTER_1_INTERRUPT_STATUS_STICKY && reg != SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL &&
+           reg != SI5351_REGISTER_177_PLL_RESET;
+}
+
+void si5351MapStored(const Si5351Store &store, const Si5351StoreEntry &entry, Si5351RegisterMap *map) {
+    const uint8_t *run = store.base + entry.offset;
+    const uint8_t *end = run + entry.length;
+
+    memset(map, 0, sizeof(*map));
+    while (run + 2 <= end && run + 2 + run[1] <= end) {
+        for (int i = 0; i < run[1]; i++) {
+            int reg = run[0] + i;
+            if (streamed(reg) || reg == SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL) {
+                si5351MapSet(map, (uint8_t)reg, run[2 + i]);
+            }
+        }
+        run += 2 + run[1];
+    }
+}
+
+/**
+ * Add the part of a run below or above one register to the block list,
+ * split into bursts.
+ */
+static void addBlocks(uint8_t reg, int length, const uint8_t *data, RegisterBlock *blocks, int *count) {
+    while (length > 0) {
+        int burst = length < I2C_MAX_BURST ? length : I2C_MAX_BURST;
+        blocks[(*count)++] = RegisterBlock{ reg, (uint8_t)burst, data, SI5351_PHASE_OTHER };
+        reg += burst;
+        data += burst;
+        length -= burst;
+    }
+}
+
+int si5351ConfigureStored(Si5351Transport *transport, const Si5351Store &store, const Si5351StoreEntry &entry, Si5351Lock *lock) {
+    static const uint8_t disableOutputs[1] = { 0xFF };
+    static const uint8_t pllReset[1] = { 0xAC };
+    RegisterBlock blocks[1 + 256];
+    int count = 0;
+    uint8_t outputEnable = 0x00;
+    uint8_t statusMask = SI5351_STATUS_SYS_INIT;
+
+    blocks[count++] = RegisterBlock{ SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 1, disableOutputs, SI5351_PHASE_DISABLE };
+
+    // Every run, minus the registers streamed() leaves out
+    const uint8_t *run = store.base + entry.offset;
+    const uint8_t *end = run + entry.length;
+    while (run + 2 <= end && run + 2 + run[1] <= end) {
+        int reg = run[0];
+        int length = run[1];
+        const uint8_t *data = run + 2;
+        int from = 0;
+        for (int i = 0; i < length; i++) {
+            int current = reg + i;
+            if (current >= SI5351_REGISTER_16_CLK0_CONTROL && current <= SI5351_REGISTER_23_CLK7_CONTROL && !(data[i] & 0x80)) {
+                statusMask |= (data[i] & 0x20) ? SI5351_STATUS_LOL_B : SI5351_STATUS_LOL_A;
+            }
+            if (!streamed(current)) {
+                if (current == SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL) {
+                    outputEnable = data[i];
+                }
+                addBlocks((uint8_t)(reg + from), i - from, data + from, blocks, &count);
+                from = i + 1;
+            }
+        }
+        addBlocks((uint8_t)(reg + from), length - from, data + from, blocks, &count);
+        run += 2 + length;
+    }
+
+    // As many messages per transfer as the transport takes
+    int sent = 0;
+    for (int first = 0; first < count; first += I2C_MAX_MESSAGES - 1) {
+        RegisterBlock batch[I2C_MAX_MESSAGES];
+        int size = count - first < I2C_MAX_MESSAGES - 1 ? count - first : I2C_MAX_MESSAGES - 1;
+        memcpy(batch, blocks + first, size * sizeof(RegisterBlock));
+        if (first + size == count) {
+            batch[size++] = RegisterBlock{ SI5351_REGISTER_177_PLL_RESET, 1, pllReset, SI5351_PHASE_RESET };
+        }
+        int messages = transport->writeBlocks(batch, size);
+        if (messages == -1) {
+            return -1;
+        }
+        sent += messages;
+    }
+
+    if (lock != nullptr && lock->deadlineUs != 0 && si5351WaitForLock(transport, statusMask, monotonicNs(), lock) == -1) {
+        return -1;
+    }
+    const RegisterBlock enable = { SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, 1, &outputEnable, SI5351_PHASE_ENABLE };
+    int messages = transport->writeBlocks(&enable, 1);
+    return messages == -1 ? -1 : sent + messages;
+}
@@ -0,0 +1,119 @@
+/*
+ * SI5351 binary preset store
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   ClockBuilder Pro register maps, imported from its CSV export
+ *   ("Address,Data" / "26,00h") or its C header export
+ *   ("{ 0x001A, 0x00 },"), are compiled into one file:
+ *
+ *     header    magic "S535", version, preset count, file size and the
+ *               CRC-32 of everything after the header
+ *     index     one entry per preset, sorted by name: name, offset and
+ *               length of its runs, number of registers
+ *     runs      per preset, (start register, length, bytes...) for every
+ *               run of consecutive registers in the map
+ *
+ *   All fields are little-endian. The program maps the file with mmap(),
+ *   checks the header and checksum, finds a preset by binary search and
+ *   writes its runs straight from the mapping to the bus.
+ */
+
+#ifndef SI5351_PRESET_STORE_H
+#define SI5351_PRESET_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Si5351Configuration.h"
+#include "Si5351Transport.h"
+
+#define SI5351_STORE_MAGIC "S535"
+#define SI5351_STORE_VERSION 1
+#define SI5351_STORE_NAME_LENGTH 24
+#define SI5351_STORE_MAX_PRESETS 1024
+
+struct Si5351StoreHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t presetCount;
+    uint32_t size;              // whole file
+    uint32_t checksum;          // CRC-32 of the bytes after the header
+};
+
+struct Si5351StoreEntry {
+    char name[SI5351_STORE_NAME_LENGTH];    // NUL-padded
+    uint32_t offset;            // of the runs, from the start of the file
+    uint16_t length;            // of the runs in bytes
+    uint16_t registerCount;
+};
+
+/**
+ * A preset file mapped into memory.
+ */
+struct Si5351Store {
+    const uint8_t *base;
+    size_t size;
+    const Si5351StoreHeader *header;
+    const Si5351StoreEntry *entries;
+};
+
+/**
+ * Read a ClockBuilder Pro register map export (CSV or C header).
+ *
+ * @param path The exported file.
+ * @param map Receives the registers it defines.
+ * @return 0 on success, -1 if the file cannot be read or holds no registers.
+ */
+int si5351ImportCbp(const char *path, Si5351RegisterMap *map);
+
+/**
+ * Write a preset file.
+ *
+ * @param path The file to create or replace (written to a temporary file and renamed).
+ * @param names Preset names, at most SI5351_STORE_NAME_LENGTH - 1 characters.
+ * @param maps The register map of each preset.
+ * @param count The number of presets.
+ * @return 0 on success, -1 on failure.
+ */
+int si5351WriteStore(const char *path, const char *const *names, const Si5351RegisterMap *maps, int count);
+
+/**
+ * Map a preset file and check its header, size and checksum.
+ *
+ * @return 0 on success, -1 if the file is missing or invalid.
+ */
+int si5351OpenStore(const char *path, Si5351Store *store);
+
+void si5351CloseStore(Si5351Store *store);
+
+/**
+ * Find a preset by name.
+ *
+ * @return The index entry, or nullptr if there is none.
+ */
+const Si5351StoreEntry *si5351FindStoredPreset(const Si5351Store &store, const char *name);
+
+/**
+ * Expand a stored preset into the register map it programs, without the
+ * status registers (0, 1) and the PLL reset (177).
+ */
+void si5351MapStored(const Si5351Store &store, const Si5351StoreEntry &entry, Si5351RegisterMap *map);
+
+/**
+ * Program a stored preset: disable the outputs, write every run except
+ * registers 0, 1, 3 and 177 straight from the mapping, reset the PLLs, wait for
+ * lock if asked to and write the stored output enable (0x00 if the map
+ * has none).
+ *
+ * @param transport The bus to the chip.
+ * @param store The mapped preset file.
+ * @param entry The preset to program.
+ * @param lock If not nullptr and its deadline is set, wait for lock before enabling.
+ * @return Number of I2C messages sent, or -1 on failure or lock timeout.
+ */
+int si5351ConfigureStored(Si5351Transport *transport, const Si5351Store &store, const Si5351StoreEntry &entry, Si5351Lock *lock);
+
+#endif // SI5351_PRESET_STORE_H
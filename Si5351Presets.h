@@ -0,0 +1,147 @@
+/*
+ * SI5351 presets for selected frequencies found in Atari 8-bit computers
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Every preset drives CLK0 from PLL A with the 25 MHz crystal, an integer
+ *   MultiSynth divider and a fractional feedback divider. The MultiSynth
+ *   dividers are the ones chosen by ClockBuilder Pro; the register images
+ *   are solved at compile time by Si5351Solver.h.
+ */
+
+#ifndef SI5351_PRESETS_H
+#define SI5351_PRESETS_H
+
+#include <string.h>
+
+#include "Si5351Solver.h"
+
+struct Si5351Preset {
+    const char *name;           // output frequency in MHz, as typed on the command line
+    const char *description;
+    uint64_t outputMilliHz;
+    uint32_t multiSynth;
+    Si5351RegisterImage image;
+};
+
+#define SI5351_PRESET(name, description, outputMilliHz, multiSynth) \
+    { name, description, outputMilliHz, multiSynth, si5351Solve(outputMilliHz, multiSynth) }
+
+constexpr Si5351Preset SI5351_PRESETS[] = {
+    // VCO 698,738118 MHz, feedback 27 610834/643305
+    SI5351_PRESET("1.773447", "Atari XL/XE PAL", 1773447000ULL, 394),
+    // VCO 698,011275 MHz, feedback 27 920451/1000000
+    SI5351_PRESET("1.7897725", "Atari XL/XE NTSC", 1789772500ULL, 390),
+    // VCO 698,017125 MHz, feedback 27 184137/200000
+    SI5351_PRESET("1.7897875", "Atari 400/800 NTSC", 1789787500ULL, 390),
+    // VCO 702,285012 MHz, feedback 28 43339/474166
+    SI5351_PRESET("3.546894", "Atari XL/XE PAL", 3546894000ULL, 198),
+    // VCO 701,590820 MHz, feedback 28 45939/721939
+    SI5351_PRESET("3.579545", "Atari XL/XE NTSC", 3579545000ULL, 196),
+    // VCO 701,596700 MHz, feedback 28 15967/250000
+    SI5351_PRESET("3.579575", "Atari 400/800 NTSC", 3579575000ULL, 196),
+    // VCO 700,511644 MHz, feedback 28 12451/608382
+    SI5351_PRESET("4.433618", "Atari PAL Crystal", 4433618000ULL, 158),
+    // VCO 716,663800 MHz, feedback 28 83319/125000
+    SI5351_PRESET("8.3333", "Atari XF551 Crystal", 8333300000ULL, 86),
+    // VCO 709,378800 MHz, feedback 28 23447/62500
+    SI5351_PRESET("14.187576", "Atari XL/XE PAL", 14187576000ULL, 50),
+    // VCO 687,272640 MHz, feedback 27 38352/78125
+    SI5351_PRESET("14.31818", "Atari XL/XE NTSC", 14318180000ULL, 48),
+};
+
+#define SI5351_PRESET_COUNT (sizeof(SI5351_PRESETS) / sizeof(SI5351_PRESETS[0]))
+
+/**
+ * Find a preset by its name (output frequency in MHz).
+ *
+ * @return The preset, or nullptr if there is none with that name.
+ */
+inline const Si5351Preset *si5351FindPreset(const char *name) {
+    for (const Si5351Preset &preset : SI5351_PRESETS) {
+        if (strcmp(preset.name, name) == 0) {
+            return &preset;
+        }
+    }
+    return nullptr;
+}
+
+constexpr bool si5351PresetsVcoInRange() {
+    for (const Si5351Preset &preset : SI5351_PRESETS) {
+        if (!si5351VcoInRange(preset.outputMilliHz, preset.multiSynth)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool si5351PresetsFeedbackInRange() {
+    for (const Si5351Preset &preset : SI5351_PRESETS) {
+        if (!si5351FeedbackInRange(preset.outputMilliHz, preset.multiSynth)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool si5351PresetsMultiSynthInRange() {
+    for (const Si5351Preset &preset : SI5351_PRESETS) {
+        if (!si5351MultiSynthInRange(preset.multiSynth)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(si5351PresetsVcoInRange(), "preset VCO outside 600-900 MHz");
+static_assert(si5351PresetsFeedbackInRange(), "preset feedback divider outside 15..90");
+static_assert(si5351PresetsMultiSynthInRange(), "preset MultiSynth divider outside 8..2048");
+
+// Registers 26-33 and 42-49 as exported by ClockBuilder Pro, in table order.
+// ClockBuilder rounds some VCO frequencies (1.773447, 3.546894, 3.579545 and
+// 4.433618 MHz are off by 6-28 ppb), so the solved images must be at least
+// as accurate rather than byte-identical.
+constexpr uint8_t SI5351_CLOCKBUILDER_IMAGES[][16] = {
+    { 0xd0, 0x90, 0x00, 0x0b, 0xf9, 0x32, 0x0e, 0x70, 0x00, 0x01, 0x00, 0xc3, 0x00, 0x00, 0x00, 0x00 },
+    { 0x42, 0x40, 0x00, 0x0b, 0xf5, 0xfc, 0x7a, 0x40, 0x00, 0x01, 0x00, 0xc1, 0x00, 0x00, 0x00, 0x00 },
+    { 0x0d, 0x40, 0x00, 0x0b, 0xf5, 0x32, 0x96, 0x40, 0x00, 0x01, 0x00, 0xc1, 0x00, 0x00, 0x00, 0x00 },
+    { 0x13, 0x88, 0x00, 0x0c, 0x0b, 0x00, 0x0d, 0xa8, 0x00, 0x01, 0x00, 0x61, 0x00, 0x00, 0x00, 0x00 },
+    { 0xf4, 0x24, 0x00, 0x0c, 0x08, 0x00, 0x23, 0x60, 0x00, 0x01, 0x00, 0x60, 0x00, 0x00, 0x00, 0x00 },
+    { 0xd0, 0x90, 0x00, 0x0c, 0x08, 0x30, 0xab, 0x00, 0x00, 0x01, 0x00, 0x60, 0x00, 0x00, 0x00, 0x00 },
+    { 0x89, 0x68, 0x00, 0x0c, 0x02, 0x95, 0xe8, 0xb0, 0x00, 0x01, 0x00, 0x4d, 0x00, 0x00, 0x00, 0x00 },
+    { 0xe8, 0x48, 0x00, 0x0c, 0x55, 0x10, 0x9b, 0x98, 0x00, 0x01, 0x00, 0x29, 0x00, 0x00, 0x00, 0x00 },
+    { 0xf4, 0x24, 0x00, 0x0c, 0x30, 0x00, 0x04, 0xc0, 0x00, 0x01, 0x00, 0x17, 0x00, 0x00, 0x00, 0x00 },
+    { 0x31, 0x2d, 0x00, 0x0b, 0xbe, 0x10, 0xff, 0x1a, 0x00, 0x01, 0x00, 0x16, 0x00, 0x00, 0x00, 0x00 },
+};
+
+/**
+ * Relative error of a register image against the intended output, in ppb.
+ */
+constexpr double si5351ErrorPpb(const uint8_t *pll, const uint8_t *multiSynth, uint64_t outputMilliHz, uint64_t xtalHz = SI5351_XTAL_FREQUENCY) {
+    double output = xtalHz * 1000.0 * si5351DividerValue(si5351Unpack(pll)) / si5351DividerValue(si5351Unpack(multiSynth));
+    double error = (output - outputMilliHz) / outputMilliHz * 1e9;
+    return error < 0 ? -error : error;
+}
+
+constexpr bool si5351PresetsMatchClockBuilder() {
+    for (unsigned i = 0; i < SI5351_PRESET_COUNT; i++) {
+        const Si5351Preset &preset = SI5351_PRESETS[i];
+        for (unsigned j = 0; j < 8; j++) {
+            if (preset.image.multiSynth[j] != SI5351_CLOCKBUILDER_IMAGES[i][8 + j]) {
+                return false;
+            }
+        }
+        if (si5351ErrorPpb(preset.image.pll, preset.image.multiSynth, preset.outputMilliHz) >
+            si5351ErrorPpb(SI5351_CLOCKBUILDER_IMAGES[i], SI5351_CLOCKBUILDER_IMAGES[i] + 8, preset.outputMilliHz) + 1e-3) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(sizeof(SI5351_CLOCKBUILDER_IMAGES) / sizeof(SI5351_CLOCKBUILDER_IMAGES[0]) == SI5351_PRESET_COUNT, "one ClockBuilder image per preset");
+static_assert(si5351PresetsMatchClockBuilder(), "solved register images less accurate than ClockBuilder Pro");
+
+#endif // SI5351_PRESETS_H
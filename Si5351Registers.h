@@ -0,0 +1,79 @@
+/*
+ * SI5351 register map and bus defaults
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#ifndef SI5351_REGISTERS_H
+#define SI5351_REGISTERS_H
+
+#define SI5351_ADDRESS 0x60
+
+#define SI5351_REGISTER_0_DEVICE_STATUS 0
+#define SI5351_REGISTER_1_INTERRUPT_STATUS_STICKY 1
+#define SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL 3
+
+#define SI5351_REGISTER_16_CLK0_CONTROL 16
+#define SI5351_REGISTER_17_CLK1_CONTROL 17
+#define SI5351_REGISTER_18_CLK2_CONTROL 18
+#define SI5351_REGISTER_19_CLK3_CONTROL 19
+#define SI5351_REGISTER_20_CLK4_CONTROL 20
+#define SI5351_REGISTER_21_CLK5_CONTROL 21
+#define SI5351_REGISTER_22_CLK6_CONTROL 22
+#define SI5351_REGISTER_23_CLK7_CONTROL 23
+#define SI5351_REGISTER_24_CLK3_0_DISABLE_STATE 24
+#define SI5351_REGISTER_25_CLK7_4_DISABLE_STATE 25
+
+#define SI5351_REGISTER_26_PLL_A_REG0 26
+#define SI5351_REGISTER_27_PLL_A_REG1 27
+#define SI5351_REGISTER_28_PLL_A_REG2 28
+#define SI5351_REGISTER_29_PLL_A_REG3 29
+#define SI5351_REGISTER_30_PLL_A_REG4 30
+#define SI5351_REGISTER_31_PLL_A_REG5 31
+#define SI5351_REGISTER_32_PLL_A_REG6 32
+#define SI5351_REGISTER_33_PLL_A_REG7 33
+
+#define SI5351_REGISTER_34_PLL_B_REG0 34
+#define SI5351_REGISTER_35_PLL_B_REG1 35
+#define SI5351_REGISTER_36_PLL_B_REG2 36
+#define SI5351_REGISTER_37_PLL_B_REG3 37
+#define SI5351_REGISTER_38_PLL_B_REG4 38
+#define SI5351_REGISTER_39_PLL_B_REG5 39
+#define SI5351_REGISTER_40_PLL_B_REG6 40
+#define SI5351_REGISTER_41_PLL_B_REG7 41
+
+#define SI5351_REGISTER_42_MULTISYNTH0_PARAMETERS_1 42
+#define SI5351_REGISTER_43_MULTISYNTH0_PARAMETERS_2 43
+#define SI5351_REGISTER_44_MULTISYNTH0_PARAMETERS_3 44
+#define SI5351_REGISTER_45_MULTISYNTH0_PARAMETERS_4 45
+#define SI5351_REGISTER_46_MULTISYNTH0_PARAMETERS_5 46
+#define SI5351_REGISTER_47_MULTISYNTH0_PARAMETERS_6 47
+#define SI5351_REGISTER_48_MULTISYNTH0_PARAMETERS_7 48
+#define SI5351_REGISTER_49_MULTISYNTH0_PARAMETERS_8 49
+
+#define SI5351_REGISTER_50_MULTISYNTH1_PARAMETERS_1 50
+#define SI5351_REGISTER_58_MULTISYNTH2_PARAMETERS_1 58
+#define SI5351_REGISTER_66_MULTISYNTH3_PARAMETERS_1 66
+#define SI5351_REGISTER_74_MULTISYNTH4_PARAMETERS_1 74
+#define SI5351_REGISTER_82_MULTISYNTH5_PARAMETERS_1 82
+#define SI5351_REGISTER_90_MULTISYNTH6_PARAMETERS 90
+#define SI5351_REGISTER_91_MULTISYNTH7_PARAMETERS 91
+#define SI5351_REGISTER_92_CLK6_7_OUTPUT_DIVIDER 92
+
+#define SI5351_REGISTER_177_PLL_RESET 177
+
+// Register 0 and 1 bits
+#define SI5351_STATUS_SYS_INIT 0x80
+#define SI5351_STATUS_LOL_B 0x40
+#define SI5351_STATUS_LOL_A 0x20
+#define SI5351_STATUS_LOS 0x10
+#define SI5351_STATUS_LOS_XTAL 0x08
+
+// Register 177 bits
+#define SI5351_PLL_RESET_A 0x20
+#define SI5351_PLL_RESET_B 0x80
+
+#define I2C_DEVICE "/dev/i2c-1"
+
+#endif // SI5351_REGISTERS_H
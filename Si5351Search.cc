@@ -0,0 +1,385 @@
+/*
+ * SI5351 low-jitter divider search
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <mutex>
+#include <thread>
+#include <time.h>
+
+#include "Si5351Search.h"
+#include "Si5351Transport.h"
+
+#define SI5351_R_DIVIDER_LOG2_MAX 7
+#define SI5351_VCO_CENTER 700000000ULL
+
+// Candidates a worker takes from its own range at a time
+#define SEARCH_CHUNK 256
+
+// Errors below this are treated as equal
+#define SEARCH_ERROR_FLOOR_PPB 0.001
+
+#define FAMILY_INTEGER_MULTISYNTH 0
+#define FAMILY_INTEGER_FEEDBACK 1
+#define FAMILY_INTEGER_BOTH 2
+#define FAMILY_VCO_GRID 3
+
+/**
+ * A run of candidate indices with one family and R divider.
+ */
+struct Segment {
+    uint64_t first;             // global index of the first candidate
+    uint64_t count;
+    uint8_t family;
+    uint8_t rDividerLog2;
+    uint64_t low;               // MultiSynth, feedback or grid start
+};
+
+struct SearchSpace {
+    uint64_t outputMilliHz;
+    uint64_t xtalHz;
+    uint64_t vcoStepMilliHz;
+    int segmentCount;
+    Segment segments[4 * (SI5351_R_DIVIDER_LOG2_MAX + 1)];
+    uint64_t total;
+};
+
+struct Front {
+    int count;
+    Si5351Candidate entries[SI5351_SEARCH_MAX_FRONT];
+};
+
+struct Worker {
+    std::mutex lock;
+    uint64_t next;
+    uint64_t end;
+    Front front;
+    uint64_t evaluated;
+    uint32_t steals;
+};
+
+static double magnitude(double x) {
+    return x < 0 ? -x : x;
+}
+
+static double dividerValue(Si5351Divider divider) {
+    return divider.a + (double)divider.b / divider.c;
+}
+
+double si5351JitterPenalty(const Si5351Candidate &candidate) {
+    double penalty = 0;
+
+    if (candidate.feedback.b != 0) {
+        penalty += SI5351_PENALTY_FRACTIONAL_FEEDBACK;
+    }
+    if (candidate.multiSynth.b != 0) {
+        penalty += SI5351_PENALTY_FRACTIONAL_MULTISYNTH;
+    } else if (candidate.multiSynth.a & 1) {
+        penalty += SI5351_PENALTY_ODD_MULTISYNTH;
+    }
+
+    // Quantized to 0.1 so that nearby VCOs compare equal
+    uint64_t vco = candidate.vcoMilliHz / 1000;
+    uint64_t distance = vco > SI5351_VCO_CENTER ? vco - SI5351_VCO_CENTER : SI5351_VCO_CENTER - vco;
+    penalty += (int)(distance * SI5351_PENALTY_VCO_PER_100MHZ * 10 / 100000000) / 10.0;
+    return penalty;
+}
+
+static double errorForComparison(const Si5351Candidate &candidate) {
+    double error = magnitude(candidate.errorPpb);
+    return error < SEARCH_ERROR_FLOOR_PPB ? 0 : error;
+}
+
+/**
+ * True if x is at least as good as y in both error and penalty, and
+ * better in one of them (or equal and with the lower VCO).
+ */
+static bool dominates(const Si5351Candidate &x, const Si5351Candidate &y) {
+    double errorX = errorForComparison(x);
+    double errorY = errorForComparison(y);
+
+    if (errorX > errorY || x.penalty > y.penalty) {
+        return false;
+    }
+    if (errorX < errorY || x.penalty < y.penalty) {
+        return true;
+    }
+    return x.vcoMilliHz < y.vcoMilliHz;
+}
+
+static void addToFront(Front *front, const Si5351Candidate &candidate) {
+    for (int i = 0; i < front->count; i++) {
+        if (dominates(front->entries[i], candidate) || (errorForComparison(front->entries[i]) == errorForComparison(candidate) &&
+                                                        front->entries[i].penalty == candidate.penalty &&
+                                                        front->entries[i].vcoMilliHz == candidate.vcoMilliHz)) {
+            return;
+        }
+    }
+
+    int kept = 0;
+    for (int i = 0; i < front->count; i++) {
+        if (!dominates(candidate, front->entries[i])) {
+            front->entries[kept++] = front->entries[i];
+        }
+    }
+    front->count = kept;
+
+    if (front->count < SI5351_SEARCH_MAX_FRONT) {
+        front->entries[front->count++] = candidate;
+    }
+}
+
+/**
+ * Build the candidate segments for every R divider that can reach the
+ * VCO range.
+ */
+static void buildSpace(SearchSpace *space) {
+    space->segmentCount = 0;
+    space->total = 0;
+
+    for (uint8_t r = 0; r <= SI5351_R_DIVIDER_LOG2_MAX; r++) {
+        uint64_t divided = space->outputMilliHz << r;
+        if (divided * SI5351_MULTISYNTH_MIN > SI5351_VCO_MAX * 1000 || divided * SI5351_MULTISYNTH_MAX < SI5351_VCO_MIN * 1000) {
+            continue;
+        }
+
+        uint64_t lowMultiSynth = (SI5351_VCO_MIN * 1000 + divided - 1) / divided;
+        uint64_t highMultiSynth = SI5351_VCO_MAX * 1000 / divided;
+        if (lowMultiSynth < SI5351_MULTISYNTH_MIN) {
+            lowMultiSynth = SI5351_MULTISYNTH_MIN;
+        }
+        if (highMultiSynth > SI5351_MULTISYNTH_MAX) {
+            highMultiSynth = SI5351_MULTISYNTH_MAX;
+        }
+        uint64_t lowFeedback = (SI5351_VCO_MIN + space->xtalHz - 1) / space->xtalHz;
+        uint64_t highFeedback = SI5351_VCO_MAX / space->xtalHz;
+
+        uint64_t feedbackCount = highFeedback >= lowFeedback ? highFeedback - lowFeedback + 1 : 0;
+
+        Segment segments[4] = {
+            { 0, highMultiSynth >= lowMultiSynth ? highMultiSynth - lowMultiSynth + 1 : 0, FAMILY_INTEGER_MULTISYNTH, r, lowMultiSynth },
+            { 0, feedbackCount, FAMILY_INTEGER_FEEDBACK, r, lowFeedback },
+            { 0, 2 * feedbackCount, FAMILY_INTEGER_BOTH, r, lowFeedback },
+            { 0, (SI5351_VCO_MAX - SI5351_VCO_MIN) * 1000 / space->vcoStepMilliHz + 1, FAMILY_VCO_GRID, r, SI5351_VCO_MIN * 1000 },
+        };
+        for (Segment &segment : segments) {
+            if (segment.count == 0) {
+                continue;
+            }
+            segment.first = space->total;
+            space->total += segment.count;
+            space->segments[space->segmentCount++] = segment;
+        }
+    }
+}
+
+/**
+ * Evaluate the candidate with the given global index.
+ *
+ * @return false if its dividers are out of range.
+ */
+static bool evaluate(const SearchSpace &space, uint64_t index, Si5351Candidate *candidate) {
+    const Segment *segment = space.segments;
+    while (index >= segment->first + segment->count) {
+        segment++;
+    }
+    uint64_t offset = index - segment->first;
+    uint64_t divided = space.outputMilliHz << segment->rDividerLog2;
+    uint64_t xtalMilliHz = space.xtalHz * 1000;
+
+    candidate->rDividerLog2 = segment->rDividerLog2;
+    switch (segment->family) {
+    case FAMILY_INTEGER_MULTISYNTH:
+        candidate->vcoMilliHz = divided * (segment->low + offset);
+        candidate->multiSynth = Si5351Divider{ (uint32_t)(segment->low + offset), 0, 1 };
+        candidate->feedback = si5351Approximate(candidate->vcoMilliHz, xtalMilliHz);
+        break;
+    case FAMILY_INTEGER_FEEDBACK:
+        candidate->vcoMilliHz = xtalMilliHz * (segment->low + offset);
+        candidate->feedback = Si5351Divider{ (uint32_t)(segment->low + offset), 0, 1 };
+        candidate->multiSynth = si5351Approximate(candidate->vcoMilliHz, divided);
+        break;
+    case FAMILY_INTEGER_BOTH:
+        // The integer MultiSynth dividers on either side of the exact ratio
+        candidate->vcoMilliHz = xtalMilliHz * (segment->low + offset / 2);
+        candidate->feedback = Si5351Divider{ (uint32_t)(segment->low + offset / 2), 0, 1 };
+        candidate->multiSynth = Si5351Divider{ (uint32_t)(candidate->vcoMilliHz / divided + (offset & 1)), 0, 1 };
+        break;
+    default:
+        candidate->vcoMilliHz = segment->low + offset * space.vcoStepMilliHz;
+        candidate->feedback = si5351Approximate(candidate->vcoMilliHz, xtalMilliHz);
+        candidate->multiSynth = si5351Approximate(candidate->vcoMilliHz, divided);
+        break;
+    }
+
+    const Si5351Divider &multiSynth = candidate->multiSynth;
+    if (multiSynth.a < SI5351_MULTISYNTH_MIN || multiSynth.a > SI5351_MULTISYNTH_MAX ||
+        (multiSynth.a == SI5351_MULTISYNTH_MAX && multiSynth.b != 0) ||
+        !si5351FeedbackDividerInRange(candidate->feedback)) {
+        return false;
+    }
+
+    double actual = space.xtalHz * dividerValue(candidate->feedback) / (dividerValue(multiSynth) * (1 << segment->rDividerLog2));
+    candidate->errorPpb = (actual * 1000 / space.outputMilliHz - 1) * 1e9;
+    candidate->penalty = si5351JitterPenalty(*candidate);
+    return true;
+}
+
+/**
+ * Take the next chunk of this worker's range, or steal half of the
+ * largest range left to another worker.
+ *
+ * @return false when there is no work left anywhere.
+ */
+static bool takeWork(Worker *workers, int count, int self, uint64_t *begin, uint64_t *end) {
+    Worker &own = workers[self];
+    {
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (own.next < own.end) {
+            *begin = own.next;
+            *end = own.end - own.next > SEARCH_CHUNK ? own.next + SEARCH_CHUNK : own.end;
+            own.next = *end;
+            return true;
+        }
+    }
+
+    for (;;) {
+        int victim = -1;
+        uint64_t largest = 0;
+        for (int i = 0; i < count; i++) {
+            std::lock_guard<std::mutex> guard(workers[i].lock);
+            if (i != self && workers[i].end - workers[i].next > largest) {
+                largest = workers[i].end - workers[i].next;
+                victim = i;
+            }
+        }
+        if (victim < 0) {
+            return false;
+        }
+
+        uint64_t stolenBegin, stolenEnd;
+        {
+            std::lock_guard<std::mutex> guard(workers[victim].lock);
+            uint64_t left = workers[victim].end - workers[victim].next;
+            if (left == 0) {
+                continue;       // finished meanwhile, look again
+            }
+            stolenBegin = workers[victim].next + left / 2;
+            stolenEnd = workers[victim].end;
+            workers[victim].end = stolenBegin;
+        }
+
+        std::lock_guard<std::mutex> guard(own.lock);
+        own.steals++;
+        own.next = stolenBegin;
+        own.end = stolenEnd;
+        *begin = own.next;
+        *end = own.end - own.next > SEARCH_CHUNK ? own.next + SEARCH_CHUNK : own.end;
+        own.next = *end;
+        return true;
+    }
+}
+
+static void work(const SearchSpace *space, Worker *workers, int count, int self) {
+    Worker &own = workers[self];
+    uint64_t begin, end;
+
+    while (takeWork(workers, count, self, &begin, &end)) {
+        for (uint64_t index = begin; index < end; index++) {
+            Si5351Candidate candidate;
+            if (evaluate(*space, index, &candidate)) {
+                addToFront(&own.front, candidate);
+            }
+        }
+        own.evaluated += end - begin;
+    }
+}
+
+int si5351Search(uint64_t outputMilliHz, uint64_t xtalHz, const Si5351SearchOptions &options, Si5351SearchResult *result) {
+    static SearchSpace space;
+    static Worker workers[SI5351_SEARCH_MAX_THREADS];
+    uint64_t start = monotonicNs();
+
+    if (outputMilliHz == 0) {
+        return -1;
+    }
+    space.outputMilliHz = outputMilliHz;
+    space.xtalHz = xtalHz;
+    space.vcoStepMilliHz = (uint64_t)(options.vcoStepHz ? options.vcoStepHz : SI5351_SEARCH_VCO_STEP_HZ) * 1000;
+    buildSpace(&space);
+    if (space.total == 0) {
+        return -1;
+    }
+
+    int threads = options.threads;
+    if (threads <= 0) {
+        threads = (int)std::thread::hardware_concurrency();
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > SI5351_SEARCH_MAX_THREADS) {
+        threads = SI5351_SEARCH_MAX_THREADS;
+    }
+
+    // Equal initial shares; stealing evens out the rest
+    for (int i = 0; i < threads; i++) {
+        workers[i].next = space.total * i / threads;
+        workers[i].end = space.total * (i + 1) / threads;
+        workers[i].front.count = 0;
+        workers[i].evaluated = 0;
+        workers[i].steals = 0;
+    }
+
+    std::thread pool[SI5351_SEARCH_MAX_THREADS];
+    for (int i = 1; i < threads; i++) {
+        pool[i] = std::thread(work, &space, workers, threads, i);
+    }
+    work(&space, workers, threads, 0);
+    for (int i = 1; i < threads; i++) {
+        pool[i].join();
+    }
+
+    Front merged;
+    merged.count = 0;
+    result->evaluated = 0;
+    result->steals = 0;
+    for (int i = 0; i < threads; i++) {
+        for (int j = 0; j < workers[i].front.count; j++) {
+            addToFront(&merged, workers[i].front.entries[j]);
+        }
+        result->evaluated += workers[i].evaluated;
+        result->steals += workers[i].steals;
+    }
+    if (merged.count == 0) {
+        return -1;
+    }
+
+    // By penalty, ascending (insertion sort, the front is small)
+    for (int i = 1; i < merged.count; i++) {
+        Si5351Candidate candidate = merged.entries[i];
+        int j = i;
+        while (j > 0 && merged.entries[j - 1].penalty > candidate.penalty) {
+            merged.entries[j] = merged.entries[j - 1];
+            j--;
+        }
+        merged.entries[j] = candidate;
+    }
+
+    double weight = options.penaltyWeightPpb;
+    result->frontCount = merged.count;
+    result->best = 0;
+    for (int i = 0; i < merged.count; i++) {
+        result->front[i] = merged.entries[i];
+        const Si5351Candidate &best = merged.entries[result->best];
+        if (magnitude(merged.entries[i].errorPpb) + weight * merged.entries[i].penalty <
+            magnitude(best.errorPpb) + weight * best.penalty) {
+            result->best = i;
+        }
+    }
+    result->threads = threads;
+    result->elapsedNs = monotonicNs() - start;
+    return 0;
+}
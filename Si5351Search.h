@@ -0,0 +1,90 @@
+/*
+ * SI5351 low-jitter divider search
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Exhaustive search for one output frequency over every R divider and
+ *   four families of PLL/MultiSynth settings:
+ *
+ *   - integer MultiSynth dividers, with the feedback fraction solved;
+ *   - integer feedback dividers (PLL integer mode), with the MultiSynth
+ *     fraction solved;
+ *   - integer feedback dividers with the nearest integer MultiSynth
+ *     dividers on either side, exact or not;
+ *   - a VCO grid from 600 to 900 MHz in steps of vcoStepHz, with both
+ *     fractions solved.
+ *
+ *   Every candidate gets its error in ppb and a jitter penalty:
+ *   fractional feedback, fractional or odd MultiSynth dividers and VCOs
+ *   away from 700 MHz cost points (the weights below are a model, not a
+ *   measurement). The result is the Pareto front of |error| against
+ *   penalty, plus the candidate with the lowest combined score
+ *   |error| + penaltyWeightPpb * penalty.
+ *
+ *   The candidate index space is split across worker threads; a worker
+ *   that runs out of work steals the upper half of the largest range
+ *   left to another worker. Fronts are merged at the end, and ties are
+ *   broken by VCO so that the result does not depend on the thread count.
+ */
+
+#ifndef SI5351_SEARCH_H
+#define SI5351_SEARCH_H
+
+#include <stdint.h>
+
+#include "Si5351Solver.h"
+
+#define SI5351_PENALTY_FRACTIONAL_FEEDBACK 2.0
+#define SI5351_PENALTY_FRACTIONAL_MULTISYNTH 2.0
+#define SI5351_PENALTY_ODD_MULTISYNTH 1.0
+#define SI5351_PENALTY_VCO_PER_100MHZ 0.5
+
+#define SI5351_SEARCH_VCO_STEP_HZ 1000
+#define SI5351_SEARCH_PENALTY_WEIGHT_PPB 10.0
+#define SI5351_SEARCH_MAX_FRONT 64
+#define SI5351_SEARCH_MAX_THREADS 64
+
+struct Si5351Candidate {
+    uint64_t vcoMilliHz;        // nominal, before the feedback is rounded
+    Si5351Divider feedback;
+    Si5351Divider multiSynth;
+    uint8_t rDividerLog2;
+    double errorPpb;            // signed, (actual - target) / target
+    double penalty;
+};
+
+struct Si5351SearchOptions {
+    int threads;                // 0 = one per core
+    uint32_t vcoStepHz;         // 0 = SI5351_SEARCH_VCO_STEP_HZ
+    double penaltyWeightPpb;    // ppb one penalty point is worth in the score
+};
+
+struct Si5351SearchResult {
+    int frontCount;
+    Si5351Candidate front[SI5351_SEARCH_MAX_FRONT];     // by penalty, ascending
+    int best;                   // index into front of the lowest score
+    uint64_t evaluated;
+    uint32_t steals;
+    int threads;
+    uint64_t elapsedNs;
+};
+
+/**
+ * Jitter penalty of a divider configuration.
+ */
+double si5351JitterPenalty(const Si5351Candidate &candidate);
+
+/**
+ * Search every divider configuration for one output.
+ *
+ * @param outputMilliHz The output frequency in millihertz.
+ * @param xtalHz The reference frequency in hertz.
+ * @param options Thread count, VCO grid step and score weight.
+ * @param result Receives the Pareto front and search counters.
+ * @return 0 on success, -1 if the frequency cannot be produced.
+ */
+int si5351Search(uint64_t outputMilliHz, uint64_t xtalHz, const Si5351SearchOptions &options, Si5351SearchResult *result);
+
+#endif // SI5351_SEARCH_H
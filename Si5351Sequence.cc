@@ -0,0 +1,196 @@
+/*
+ * SI5351 timed frequency sequence player
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <algorithm>
+#include <errno.h>
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Si5351Presets.h"
+#include "Si5351Sequence.h"
+
+/**
+ * Parse one timeline line.
+ *
+ * @return 1 for a step, 0 for a blank or comment line, -1 on error.
+ */
+static int parseLine(char *line, Si5351Step *step) {
+    char *comment = strchr(line, '#');
+    if (comment != nullptr) {
+        *comment = '\0';
+    }
+
+    char *offset = strtok(line, " \t\r\n");
+    char *target = strtok(nullptr, " \t\r\n");
+    if (offset == nullptr) {
+        return 0;
+    }
+    if (target == nullptr || strtok(nullptr, " \t\r\n") != nullptr || strlen(target) >= sizeof(step->target)) {
+        return -1;
+    }
+
+    char *end;
+    double offsetMs = strtod(offset, &end);
+    if (*end != '\0' || !(offsetMs >= 0)) {
+        return -1;
+    }
+    step->offsetNs = (uint64_t)llround(offsetMs * 1e6);
+    strcpy(step->target, target);
+
+    const Si5351Preset *preset = si5351FindPreset(target);
+    if (preset != nullptr) {
+        si5351MapClock0(preset->image, 0x00, &step->map);
+        return 1;
+    }
+    uint64_t outputMilliHz;
+    Si5351Solution solution;
+    if (si5351ParseMilliHz(target, &outputMilliHz) == -1 ||
+        si5351SolveFrequency(outputMilliHz, SI5351_XTAL_FREQUENCY, 0, &solution) == -1) {
+        return -1;
+    }
+    si5351MapClock0(solution.image, 0x00, &step->map);
+    return 1;
+}
+
+int si5351LoadSequence(const char *path, Si5351Sequence *sequence) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        perror("Failed to open the timeline");
+        return -1;
+    }
+
+    char line[256];
+    int lineNumber = 0;
+    int result = 0;
+    sequence->count = 0;
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        lineNumber++;
+        Si5351Step step;
+        memset(&step, 0, sizeof(step));
+        int parsed = parseLine(line, &step);
+        if (parsed == 0) {
+            continue;
+        }
+        if (parsed == -1) {
+            fprintf(stderr, "%s:%d: expected <offset ms> <preset or Hz>\n", path, lineNumber);
+            result = -1;
+            break;
+        }
+        if (sequence->count == SI5351_SEQUENCE_MAX_STEPS) {
+            fprintf(stderr, "%s:%d: too many steps\n", path, lineNumber);
+            result = -1;
+            break;
+        }
+        if (sequence->count > 0 && step.offsetNs < sequence->steps[sequence->count - 1].offsetNs) {
+            fprintf(stderr, "%s:%d: offsets must not decrease\n", path, lineNumber);
+            result = -1;
+            break;
+        }
+        sequence->steps[sequence->count++] = step;
+    }
+
+    fclose(file);
+    return result;
+}
+
+int si5351PlaySequence(Si5351Transport *transport, Si5351Sequence *sequence, const Si5351SequenceOptions &options) {
+    static Si5351RegisterMap current;
+    int oldPolicy = sched_getscheduler(0);
+    struct sched_param oldParam;
+    sched_getparam(0, &oldParam);
+
+    int timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer < 0) {
+        perror("Failed to create the step timer");
+        return -1;
+    }
+
+    // Not fatal: the sequence still plays, only with more jitter
+    if (options.realtime) {
+        struct sched_param param = {};
+        param.sched_priority = SI5351_SEQUENCE_PRIORITY;
+        if (sched_setscheduler(0, SCHED_FIFO, &param) < 0) {
+            perror("SCHED_FIFO not available");
+        }
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+            perror("mlockall failed");
+        }
+    }
+
+    // Nothing is known about the chip, so the first step writes every register
+    memset(&current, 0, sizeof(current));
+    uint64_t startNs = monotonicNs() + SI5351_SEQUENCE_LEAD_MS * 1000000ULL;
+    int failures = 0;
+    for (int i = 0; i < sequence->count; i++) {
+        Si5351Step &step = sequence->steps[i];
+        uint64_t scheduledNs = startNs + step.offsetNs;
+
+        struct itimerspec expiry = {};
+        expiry.it_value.tv_sec = scheduledNs / 1000000000ULL;
+        expiry.it_value.tv_nsec = scheduledNs % 1000000000ULL;
+        step.expirations = 0;
+        if (timerfd_settime(timer, TFD_TIMER_ABSTIME, &expiry, nullptr) < 0) {
+            perror("Failed to arm the step timer");
+            failures = -1;
+            break;
+        }
+        while (read(timer, &step.expirations, sizeof(step.expirations)) < 0 && errno == EINTR) {
+        }
+        uint64_t wakeNs = monotonicNs();
+
+        Si5351Lock lock = {};
+        lock.deadlineUs = options.lockDeadlineUs;
+        step.ok = si5351UpdateRegisters(transport, &current, step.map, &lock, &step.update) == 0;
+        step.wakeNs = (int64_t)(wakeNs - scheduledNs);
+        step.switchNs = (int64_t)(monotonicNs() - scheduledNs);
+        step.lockUs = lock.locked ? lock.lockUs : 0;
+        failures += !step.ok;
+    }
+
+    close(timer);
+    if (options.realtime) {
+        munlockall();
+        sched_setscheduler(0, oldPolicy, &oldParam);
+    }
+    return failures;
+}
+
+void si5351SequenceJitter(const Si5351Sequence &sequence, bool completion, Si5351Jitter *jitter) {
+    double samples[SI5351_SEQUENCE_MAX_STEPS];
+    double sum = 0;
+    int count = 0;
+
+    for (int i = 0; i < sequence.count; i++) {
+        if (sequence.steps[i].ok) {
+            samples[count] = (completion ? sequence.steps[i].switchNs : sequence.steps[i].wakeNs) / 1000.0;
+            sum += samples[count++];
+        }
+    }
+
+    memset(jitter, 0, sizeof(*jitter));
+    jitter->count = count;
+    if (count == 0) {
+        return;
+    }
+    std::sort(samples, samples + count);
+    jitter->minUs = samples[0];
+    jitter->maxUs = samples[count - 1];
+    jitter->meanUs = sum / count;
+    double squares = 0;
+    for (int i = 0; i < count; i++) {
+        squares += (samples[i] - jitter->meanUs) * (samples[i] - jitter->meanUs);
+    }
+    jitter->stddevUs = sqrt(squares / count);
+    jitter->p99Us = samples[(count * 99 + 99) / 100 - 1];
+}
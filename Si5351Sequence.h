@@ -0,0 +1,95 @@
+/*
+ * SI5351 timed frequency sequence player
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Steps CLK0 through a timeline with one line per step:
+ *
+ *     # offset in ms   preset or frequency in Hz
+ *     0                3.546894        # PAL
+ *     2000             3.579545        # NTSC
+ *     4000             4000000         # turbo
+ *
+ *   Every step is solved into a register map before the player starts,
+ *   so switching only writes the registers that differ from the previous
+ *   step. Each switch is started by an absolute CLOCK_MONOTONIC timerfd
+ *   expiry, optionally with SCHED_FIFO and the memory locked, and the
+ *   scheduled, wake-up and completion times of every step are recorded.
+ */
+
+#ifndef SI5351_SEQUENCE_H
+#define SI5351_SEQUENCE_H
+
+#include <stdint.h>
+
+#include "Si5351Configuration.h"
+#include "Si5351Transport.h"
+
+#define SI5351_SEQUENCE_MAX_STEPS 256
+#define SI5351_SEQUENCE_PRIORITY 50
+#define SI5351_SEQUENCE_LEAD_MS 10     // from the start of the player to offset 0
+
+struct Si5351Step {
+    uint64_t offsetNs;          // from the start of the sequence
+    char target[32];            // as written in the timeline
+    Si5351RegisterMap map;
+
+    // Result
+    bool ok;
+    uint64_t expirations;       // timer expirations read; more than 1 means the step was late
+    int64_t wakeNs;             // timer wake-up minus the scheduled time
+    int64_t switchNs;           // new clock running minus the scheduled time
+    Si5351Update update;
+    uint32_t lockUs;
+};
+
+struct Si5351Sequence {
+    int count;
+    Si5351Step steps[SI5351_SEQUENCE_MAX_STEPS];
+};
+
+struct Si5351SequenceOptions {
+    bool realtime;              // SCHED_FIFO at SI5351_SEQUENCE_PRIORITY and mlockall()
+    uint32_t lockDeadlineUs;    // 0 = do not wait for lock after a PLL reset
+};
+
+/**
+ * Distribution of one per-step time over the steps that succeeded.
+ */
+struct Si5351Jitter {
+    int count;
+    double minUs;
+    double meanUs;
+    double maxUs;
+    double stddevUs;
+    double p99Us;
+};
+
+/**
+ * Read a timeline and solve every step.
+ *
+ * @param path The timeline file; offsets must not decrease.
+ * @param sequence Receives the steps.
+ * @return 0 on success, -1 on a malformed timeline (reported on stderr).
+ */
+int si5351LoadSequence(const char *path, Si5351Sequence *sequence);
+
+/**
+ * Play a sequence once.
+ *
+ * @param transport The bus to the chip.
+ * @param sequence The steps; their results are filled in.
+ * @param options Scheduling and lock options.
+ * @return Number of steps that failed, or -1 if the timer could not be set up.
+ */
+int si5351PlaySequence(Si5351Transport *transport, Si5351Sequence *sequence, const Si5351SequenceOptions &options);
+
+/**
+ * Summarize the wake-up (completion false) or completion (completion
+ * true) times of a played sequence, relative to the schedule.
+ */
+void si5351SequenceJitter(const Si5351Sequence &sequence, bool completion, Si5351Jitter *jitter);
+
+#endif // SI5351_SEQUENCE_H
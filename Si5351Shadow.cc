@@ -0,0 +1,77 @@
+/*
+ * SI5351 shadow register file
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <string.h>
+
+#include "Si5351Shadow.h"
+
+/**
+ * Set the dirty bit of a staged register from the known chip value.
+ */
+static void track(Si5351Shadow *shadow, uint8_t reg) {
+    bool dirty = si5351MapDefined(shadow->staged, reg) &&
+                 (!si5351MapDefined(shadow->chip, reg) || shadow->chip.values[reg] != shadow->staged.values[reg]);
+    uint8_t bit = 1 << (reg & 7);
+    if (dirty != si5351ShadowDirty(*shadow, reg)) {
+        shadow->dirty[reg >> 3] ^= bit;
+        shadow->dirtyCount += dirty ? 1 : -1;
+    }
+}
+
+void si5351ShadowReset(Si5351Shadow *shadow) {
+    memset(shadow, 0, sizeof(*shadow));
+}
+
+void si5351ShadowKnown(Si5351Shadow *shadow, uint8_t reg, uint8_t value) {
+    si5351MapSet(&shadow->chip, reg, value);
+    if (!si5351MapDefined(shadow->staged, reg)) {
+        si5351MapSet(&shadow->staged, reg, value);
+    }
+    track(shadow, reg);
+}
+
+void si5351ShadowSet(Si5351Shadow *shadow, uint8_t reg, uint8_t value) {
+    if (reg == SI5351_REGISTER_177_PLL_RESET) {
+        return;
+    }
+    si5351MapSet(&shadow->staged, reg, value);
+    track(shadow, reg);
+}
+
+void si5351ShadowSetBlock(Si5351Shadow *shadow, uint8_t reg, const uint8_t *values, int length) {
+    for (int i = 0; i < length && reg + i < 256; i++) {
+        si5351ShadowSet(shadow, (uint8_t)(reg + i), values[i]);
+    }
+}
+
+void si5351ShadowStage(Si5351Shadow *shadow, const Si5351RegisterMap &map) {
+    for (int reg = 0; reg < 256; reg++) {
+        if (si5351MapDefined(map, reg)) {
+            si5351ShadowSet(shadow, (uint8_t)reg, map.values[reg]);
+        }
+    }
+}
+
+void si5351ShadowDiscard(Si5351Shadow *shadow) {
+    shadow->staged = shadow->chip;
+    memset(shadow->dirty, 0, sizeof(shadow->dirty));
+    shadow->dirtyCount = 0;
+}
+
+int si5351ShadowCommit(Si5351Transport *transport, Si5351Shadow *shadow, Si5351Lock *lock, Si5351Update *update) {
+    if (shadow->dirtyCount == 0) {
+        memset(update, 0, sizeof(*update));
+        return 0;
+    }
+
+    // The staged map holds every known chip value, so only dirty registers differ
+    int result = si5351UpdateRegisters(transport, &shadow->chip, shadow->staged, lock, update);
+    for (int reg = 0; reg < 256; reg++) {
+        track(shadow, (uint8_t)reg);
+    }
+    return result;
+}
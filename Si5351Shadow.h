@@ -0,0 +1,90 @@
+/*
+ * SI5351 shadow register file
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   An in-memory copy of what the chip holds, for long-running tools
+ *   that change a few registers at a time. Changes are staged register by
+ *   register or as a whole register map; a register is dirty while its
+ *   staged value differs from the known chip value, or the chip value is
+ *   unknown. Staging a value the chip already holds, or staging a change
+ *   and then the old value again, leaves nothing to write.
+ *
+ *   A commit writes only the dirty registers through
+ *   si5351UpdateRegisters(): dirty registers up to SI5351_UPDATE_MERGE_GAP
+ *   apart share one burst, the bursts go out in as few transfers as the
+ *   message limit allows, and if a PLL register is dirty they are ordered
+ *   outputs off, CLK control, PLL, MultiSynth, PLL reset, outputs on.
+ *
+ *   Nothing is known about the chip at first, so the first commit writes
+ *   everything staged. Register 177 (PLL reset) is not staged: the commit
+ *   resets the PLLs when their registers change.
+ */
+
+#ifndef SI5351_SHADOW_H
+#define SI5351_SHADOW_H
+
+#include <stdint.h>
+
+#include "Si5351Configuration.h"
+#include "Si5351Transport.h"
+
+struct Si5351Shadow {
+    Si5351RegisterMap chip;     // what the chip is known to hold
+    Si5351RegisterMap staged;   // the chip values with the staged changes applied
+    uint8_t dirty[32];          // bit per register
+    int dirtyCount;
+};
+
+/**
+ * Forget what the chip holds and every staged change, e.g. after the
+ * chip was reset or reprogrammed behind the shadow's back.
+ */
+void si5351ShadowReset(Si5351Shadow *shadow);
+
+/**
+ * Record a value read back from the chip, without staging a change.
+ */
+void si5351ShadowKnown(Si5351Shadow *shadow, uint8_t reg, uint8_t value);
+
+/**
+ * Stage one register value. Register 177 is ignored.
+ */
+void si5351ShadowSet(Si5351Shadow *shadow, uint8_t reg, uint8_t value);
+
+/**
+ * Stage a run of consecutive registers.
+ */
+void si5351ShadowSetBlock(Si5351Shadow *shadow, uint8_t reg, const uint8_t *values, int length);
+
+/**
+ * Stage every register a map defines.
+ */
+void si5351ShadowStage(Si5351Shadow *shadow, const Si5351RegisterMap &map);
+
+inline bool si5351ShadowDirty(const Si5351Shadow &shadow, uint8_t reg) {
+    return shadow.dirty[reg >> 3] & (1 << (reg & 7));
+}
+
+/**
+ * Drop the staged changes that have not been committed.
+ */
+void si5351ShadowDiscard(Si5351Shadow *shadow);
+
+/**
+ * Write the dirty registers. Afterwards the registers written are clean;
+ * after a lock timeout the output enable stays dirty, and after a bus
+ * failure everything staged is dirty again, since what the chip holds
+ * is unknown.
+ *
+ * @param transport The bus to the chip.
+ * @param shadow The shadow register file.
+ * @param lock If not nullptr and its deadline is set, wait for lock after a PLL reset.
+ * @param update Receives what was written; all zero if nothing was dirty.
+ * @return 0 on success, -1 on failure or lock timeout.
+ */
+int si5351ShadowCommit(Si5351Transport *transport, Si5351Shadow *shadow, Si5351Lock *lock, Si5351Update *update);
+
+#endif // SI5351_SHADOW_H
@@ -0,0 +1,138 @@
+/*
+ * SI5351 software simulator
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+#include "Si5351Simulator.h"
+
+// Set by injectFault(), taken by the next transfer
+static volatile sig_atomic_t pendingFaults = 0;
+
+Si5351Simulator::Si5351Simulator(uint32_t busHz, int address)
+    : Si5351Transport(address), transfers(0), messages(0), bytes(0), busNs(0), busHz(busHz), pointer(0), xtalLostNs(0) {
+    powerOn(monotonicNs());
+}
+
+void Si5351Simulator::injectFault(int faults) {
+    pendingFaults = pendingFaults | faults;
+}
+
+void Si5351Simulator::powerOn(uint64_t now) {
+    memset(registers, 0, sizeof(registers));
+    initDoneNs = now + SI5351_SIMULATOR_INIT_US * 1000ULL;
+    lockedNs[0] = lockedNs[1] = initDoneNs + SI5351_SIMULATOR_LOCK_US * 1000ULL;
+
+    // Power-on defaults: all outputs disabled and powered down
+    registers[SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL] = 0xFF;
+    for (int i = 0; i < 8; i++) {
+        registers[SI5351_REGISTER_16_CLK0_CONTROL + i] = 0x80;
+    }
+    updateStatus(now);
+}
+
+uint64_t Si5351Simulator::busTimeNs(const struct i2c_msg *messages, int count, uint32_t busHz) {
+    if (busHz == 0) {
+        return 0;
+    }
+
+    return si5351WireBits(messages, count) * 1000000000ULL / busHz;
+}
+
+void Si5351Simulator::updateStatus(uint64_t now) {
+    uint8_t status = 0;
+
+    if (now < initDoneNs) {
+        status |= SI5351_STATUS_SYS_INIT;
+    }
+    if (now < lockedNs[0]) {
+        status |= SI5351_STATUS_LOL_A;
+    }
+    if (now < lockedNs[1]) {
+        status |= SI5351_STATUS_LOL_B;
+    }
+    if (now < xtalLostNs) {
+        status |= SI5351_STATUS_LOS_XTAL | SI5351_STATUS_LOL_A | SI5351_STATUS_LOL_B;
+    }
+    registers[SI5351_REGISTER_0_DEVICE_STATUS] = status;
+    registers[SI5351_REGISTER_1_INTERRUPT_STATUS_STICKY] |= status;
+}
+
+int Si5351Simulator::transfer(struct i2c_msg *list, int count) {
+    uint64_t start = monotonicNs();
+    uint64_t duration = busTimeNs(list, count, busHz);
+
+    for (int i = 0; i < count; i++) {
+        if (list[i].addr != deviceAddress) {
+            errno = ENXIO;      // no ACK
+            return -1;
+        }
+    }
+
+    int faults = pendingFaults;
+    if (faults != 0) {
+        pendingFaults = 0;
+        if (faults & SI5351_SIMULATOR_FAULT_BROWNOUT) {
+            powerOn(start);
+        }
+        if (faults & SI5351_SIMULATOR_FAULT_XTAL) {
+            // Without a reference the PLLs drop out; they relock once it is back
+            xtalLostNs = start + SI5351_SIMULATOR_XTAL_LOSS_US * 1000ULL;
+            lockedNs[0] = lockedNs[1] = xtalLostNs + SI5351_SIMULATOR_LOCK_US * 1000ULL;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        struct i2c_msg &message = list[i];
+
+        if (message.flags & I2C_M_RD) {
+            updateStatus(start);
+            for (int j = 0; j < message.len; j++) {
+                message.buf[j] = registers[pointer++];
+            }
+        } else if (message.len > 0) {
+            pointer = message.buf[0];
+            for (int j = 1; j < message.len; j++) {
+                uint8_t reg = pointer++;
+                uint8_t value = message.buf[j];
+
+                if (reg == SI5351_REGISTER_0_DEVICE_STATUS) {
+                    continue;   // read only
+                }
+                if (reg == SI5351_REGISTER_177_PLL_RESET) {
+                    if (value & SI5351_PLL_RESET_A) {
+                        lockedNs[0] = start + duration + SI5351_SIMULATOR_LOCK_US * 1000ULL;
+                    }
+                    if (value & SI5351_PLL_RESET_B) {
+                        lockedNs[1] = start + duration + SI5351_SIMULATOR_LOCK_US * 1000ULL;
+                    }
+                    value &= ~(SI5351_PLL_RESET_A | SI5351_PLL_RESET_B);
+                }
+                registers[reg] = value;
+            }
+        }
+        bytes += 1 + message.len;
+    }
+
+    transfers++;
+    messages += count;
+    busNs += duration;
+
+    // Hold the caller for as long as the transfer would occupy the bus
+    if (duration > 0) {
+        struct timespec until;
+        uint64_t end = start + duration;
+        until.tv_sec = end / 1000000000ULL;
+        until.tv_nsec = end % 1000000000ULL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr) == EINTR) {
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * SI5351 software simulator
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   A transport that models the chip and the bus, so every mode of the
+ *   program can be run and timed without a Raspberry Pi:
+ *
+ *   - 256 registers behind a register pointer that auto-increments on
+ *     every data byte written or read, as on the real device;
+ *   - register 0 reports SYS_INIT for SI5351_SIMULATOR_INIT_US after the
+ *     simulator is created, and LOL_A / LOL_B until the PLLs have locked;
+ *   - register 1 latches the same events (sticky) until written with 0;
+ *   - writing PLLA_RST / PLLB_RST to register 177 unlocks that PLL for
+ *     SI5351_SIMULATOR_LOCK_US; the reset bits read back as 0;
+ *   - injectFault() models a brown-out (registers back to their power-on
+ *     defaults, SYS_INIT as after start-up) or the loss of the crystal
+ *     for SI5351_SIMULATOR_XTAL_LOSS_US (LOS_XTAL, and LOL of both PLLs
+ *     until they have locked again);
+ *   - every transfer takes the time it would take on the wire at the
+ *     configured bus speed (START, 9 bits per byte, STOP), and the caller
+ *     is held for that long in real time. A bus speed of 0 disables the
+ *     timing model.
+ *
+ *   The init and lock times are model assumptions, not datasheet limits.
+ */
+
+#ifndef SI5351_SIMULATOR_H
+#define SI5351_SIMULATOR_H
+
+#include <stdint.h>
+
+#include "Si5351Transport.h"
+
+#define SI5351_SIMULATOR_INIT_US 10000
+#define SI5351_SIMULATOR_LOCK_US 1000
+#define SI5351_SIMULATOR_XTAL_LOSS_US 50000
+
+// Faults for injectFault()
+#define SI5351_SIMULATOR_FAULT_BROWNOUT 0x01
+#define SI5351_SIMULATOR_FAULT_XTAL 0x02
+
+class Si5351Simulator : public Si5351Transport {
+public:
+    /**
+     * @param busHz Bus clock to model: 100000, 400000, 1000000, or 0 for none.
+     * @param address The address the simulated chip answers to.
+     */
+    explicit Si5351Simulator(uint32_t busHz = 100000, int address = SI5351_ADDRESS);
+
+    int transfer(struct i2c_msg *messages, int count) override;
+
+    /**
+     * Nanoseconds the given transfer occupies the bus at busHz.
+     */
+    static uint64_t busTimeNs(const struct i2c_msg *messages, int count, uint32_t busHz);
+
+    /**
+     * Have the simulated chip suffer a fault at its next transfer. Safe to
+     * call from a signal handler.
+     *
+     * @param faults SI5351_SIMULATOR_FAULT_* bits.
+     */
+    static void injectFault(int faults);
+
+    uint8_t registers[256];
+
+    // Totals since creation
+    uint32_t transfers;
+    uint32_t messages;
+    uint32_t bytes;             // on the wire, address bytes included
+    uint64_t busNs;
+
+private:
+    void powerOn(uint64_t now);
+    void updateStatus(uint64_t now);
+
+    uint32_t busHz;
+    uint8_t pointer;
+    uint64_t initDoneNs;
+    uint64_t lockedNs[2];       // PLL A, PLL B
+    uint64_t xtalLostNs;        // crystal missing until then
+};
+
+#endif // SI5351_SIMULATOR_H
@@ -0,0 +1,151 @@
+/*
+ * SI5351 runtime divider solver
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Searches MultiSynth and R divider choices for an arbitrary output
+ *   frequency and keeps the register image with the lowest error. The
+ *   feedback fraction of every candidate comes from the same continued
+ *   fraction approximation the compile-time presets use.
+ */
+
+#include "Si5351Solver.h"
+
+#define SI5351_R_DIVIDER_LOG2_MAX 7
+#define SI5351_VCO_CENTER 700000000ULL
+
+// Errors below this are far under any crystal's accuracy; stop searching
+#define SI5351_SOLVER_ERROR_FLOOR_PPB 0.001
+
+/**
+ * Fill in a solution for one (MultiSynth, R) choice.
+ */
+static void evaluate(uint64_t outputMilliHz, uint64_t xtalHz, uint32_t multiSynth, uint8_t rDividerLog2, Si5351Solution *candidate) {
+    uint64_t vcoMilliHz = (outputMilliHz << rDividerLog2) * multiSynth;
+    Si5351Divider feedback = si5351FeedbackDivider(vcoMilliHz, xtalHz);
+
+    // xtal * (a + b/c) - vco, scaled by c so that it stays an exact integer
+    int64_t error = (int64_t)(((uint64_t)feedback.a * feedback.c + feedback.b) * xtalHz * 1000) - (int64_t)(vcoMilliHz * feedback.c);
+
+    candidate->feedback = feedback;
+    candidate->multiSynth = multiSynth;
+    candidate->rDividerLog2 = rDividerLog2;
+    candidate->errorPpb = (double)error / ((double)vcoMilliHz * feedback.c) * 1e9;
+}
+
+/**
+ * Evaluate one MultiSynth divider and keep it if it beats the best so far.
+ */
+static void consider(uint64_t outputMilliHz, uint64_t xtalHz, uint32_t multiSynth, uint8_t rDividerLog2, Si5351Solution *best, bool *found) {
+    Si5351Solution candidate;
+    evaluate(outputMilliHz, xtalHz, multiSynth, rDividerLog2, &candidate);
+
+    double error = candidate.errorPpb < 0 ? -candidate.errorPpb : candidate.errorPpb;
+    double bestError = best->errorPpb < 0 ? -best->errorPpb : best->errorPpb;
+    if (!*found || error < bestError) {
+        *best = candidate;
+        *found = true;
+    }
+}
+
+static bool closeEnough(const Si5351Solution &solution) {
+    return solution.errorPpb < SI5351_SOLVER_ERROR_FLOOR_PPB && solution.errorPpb > -SI5351_SOLVER_ERROR_FLOOR_PPB;
+}
+
+int si5351SolveFrequency(uint64_t outputMilliHz, uint64_t xtalHz, uint32_t multiSynth, Si5351Solution *solution) {
+    if (outputMilliHz == 0) {
+        return -1;
+    }
+
+    // Smallest R divider that lets an integer MultiSynth reach the VCO range
+    uint8_t rDividerLog2 = 0;
+    while ((outputMilliHz << rDividerLog2) * SI5351_MULTISYNTH_MAX < SI5351_VCO_MIN * 1000) {
+        if (++rDividerLog2 > SI5351_R_DIVIDER_LOG2_MAX) {
+            return -1;
+        }
+    }
+    uint64_t divided = outputMilliHz << rDividerLog2;
+
+    Si5351Solution best = {};
+    bool found = false;
+
+    if (multiSynth != 0) {
+        if (!si5351MultiSynthInRange(multiSynth) || !si5351VcoInRange(divided, multiSynth)) {
+            return -1;
+        }
+        evaluate(outputMilliHz, xtalHz, multiSynth, rDividerLog2, &best);
+        found = true;
+    } else {
+        int64_t lowest = (int64_t)((SI5351_VCO_MIN * 1000 + divided - 1) / divided);
+        int64_t highest = (int64_t)(SI5351_VCO_MAX * 1000 / divided);
+        if (lowest < SI5351_MULTISYNTH_MIN) {
+            lowest = SI5351_MULTISYNTH_MIN;
+        }
+        if (highest > SI5351_MULTISYNTH_MAX) {
+            highest = SI5351_MULTISYNTH_MAX;
+        }
+        if (lowest > highest) {
+            return -1;
+        }
+
+        // Even dividers first, then odd; each pass walks outwards from 700 MHz
+        int64_t center = (int64_t)(SI5351_VCO_CENTER * 1000 / divided);
+        for (int parity = 0; parity < 2 && !(found && closeEnough(best)); parity++) {
+            int64_t start = (center & ~1LL) + parity;
+            for (int64_t offset = 0; ; offset += 2) {
+                int64_t up = start + offset;
+                int64_t down = start - offset - 2;
+                if (up > highest && down < lowest) {
+                    break;
+                }
+                if (up >= lowest && up <= highest) {
+                    consider(outputMilliHz, xtalHz, (uint32_t)up, rDividerLog2, &best, &found);
+                }
+                if (down >= lowest && down <= highest) {
+                    consider(outputMilliHz, xtalHz, (uint32_t)down, rDividerLog2, &best, &found);
+                }
+                if (found && closeEnough(best)) {
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!found || !si5351FeedbackDividerInRange(best.feedback)) {
+        return -1;
+    }
+
+    best.image = si5351Solve(outputMilliHz, best.multiSynth, xtalHz, best.rDividerLog2);
+    *solution = best;
+    return 0;
+}
+
+/**
+ * Parse a frequency in hertz with up to three decimals ("1789772.5").
+ *
+ * @return 0 on success, -1 if the text is not a frequency.
+ */
+int si5351ParseMilliHz(const char *text, uint64_t *milliHz) {
+    uint64_t value = 0;
+    int decimals = -1;
+
+    for (const char *c = text; *c != '\0'; c++) {
+        if (*c == '.' && decimals < 0) {
+            decimals = 0;
+        } else if (*c >= '0' && *c <= '9' && decimals < 3) {
+            value = value * 10 + (*c - '0');
+            if (decimals >= 0) {
+                decimals++;
+            }
+        } else {
+            return -1;
+        }
+    }
+    for (int i = decimals < 0 ? 0 : decimals; i < 3; i++) {
+        value *= 10;
+    }
+    *milliHz = value;
+    return value == 0 ? -1 : 0;
+}
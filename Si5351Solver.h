@@ -0,0 +1,259 @@
+/*
+ * SI5351 PLL and MultiSynth divider solver
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Computes the a + b/c feedback divider for a given output frequency and
+ *   MultiSynth divider, encodes it as the P1/P2/P3 parameters described in
+ *   Silicon Labs AN619, and lays the parameters out as the 8-byte register
+ *   images of PLL A (registers 26-33) and MultiSynth0 (registers 42-49).
+ *   Everything is constexpr, so fixed presets are solved by the compiler.
+ *
+ *   Frequencies are carried in millihertz so that presets such as
+ *   1.7897725 MHz are exact integers.
+ */
+
+#ifndef SI5351_SOLVER_H
+#define SI5351_SOLVER_H
+
+#include <stdint.h>
+
+#define SI5351_XTAL_FREQUENCY 25000000ULL
+
+#define SI5351_VCO_MIN 600000000ULL
+#define SI5351_VCO_MAX 900000000ULL
+
+#define SI5351_FEEDBACK_MIN 15
+#define SI5351_FEEDBACK_MAX 90
+#define SI5351_DENOMINATOR_MAX 1048575
+
+#define SI5351_MULTISYNTH_MIN 8
+#define SI5351_MULTISYNTH_MAX 2048
+
+#define SI5351_CLK_CONTROL_INTEGER_MODE 0x40
+#define SI5351_CLK_CONTROL_PLL_B 0x20
+#define SI5351_CLK_CONTROL_MULTISYNTH_8MA 0x0F
+
+/**
+ * Divider value a + b/c.
+ */
+struct Si5351Divider {
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+};
+
+/**
+ * Divider encoded as the P1/P2/P3 register parameters.
+ */
+struct Si5351Parameters {
+    uint32_t p1;
+    uint32_t p2;
+    uint32_t p3;
+};
+
+/**
+ * Register contents needed to drive CLK0 from PLL A.
+ */
+struct Si5351RegisterImage {
+    uint8_t clockControl;   // register 16
+    uint8_t pll[8];         // registers 26-33
+    uint8_t multiSynth[8];  // registers 42-49
+};
+
+constexpr uint64_t si5351Gcd(uint64_t x, uint64_t y) {
+    while (y != 0) {
+        uint64_t t = x % y;
+        x = y;
+        y = t;
+    }
+    return x;
+}
+
+/**
+ * Best rational approximation of numerator / denominator with a
+ * denominator not above SI5351_DENOMINATOR_MAX (continued fractions).
+ * Exact fractions that fit are returned in lowest terms.
+ */
+constexpr Si5351Divider si5351Approximate(uint64_t numerator, uint64_t denominator) {
+    uint64_t a = numerator / denominator;
+    uint64_t n = numerator % denominator;
+    uint64_t d = denominator;
+    uint64_t p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+
+    while (d != 0) {
+        uint64_t term = n / d;
+        uint64_t q2 = q0 + term * q1;
+        if (q2 > SI5351_DENOMINATOR_MAX) {
+            break;
+        }
+        uint64_t p2 = p0 + term * p1;
+        p0 = p1;
+        q0 = q1;
+        p1 = p2;
+        q1 = q2;
+        uint64_t t = n - term * d;
+        n = d;
+        d = t;
+    }
+
+    uint64_t b = p1;
+    uint64_t c = q1;
+    if (d != 0) {
+        // Semiconvergent between the last two convergents
+        uint64_t k = (SI5351_DENOMINATOR_MAX - q0) / q1;
+        uint64_t bs = p0 + k * p1;
+        uint64_t cs = q0 + k * q1;
+        uint64_t remainder = numerator % denominator;
+        uint64_t error = p1 * denominator > remainder * q1 ? p1 * denominator - remainder * q1 : remainder * q1 - p1 * denominator;
+        uint64_t errorSemi = bs * denominator > remainder * cs ? bs * denominator - remainder * cs : remainder * cs - bs * denominator;
+        if (errorSemi * q1 < error * cs) {
+            b = bs;
+            c = cs;
+        }
+    }
+    if (b == 0) {
+        c = 1;
+    }
+    return Si5351Divider{ (uint32_t)a, (uint32_t)b, (uint32_t)c };
+}
+
+/**
+ * Feedback divider for vco / xtal.
+ *
+ * @param vcoMilliHz The VCO frequency in millihertz.
+ * @param xtalHz The reference frequency in hertz.
+ */
+constexpr Si5351Divider si5351FeedbackDivider(uint64_t vcoMilliHz, uint64_t xtalHz) {
+    return si5351Approximate(vcoMilliHz, xtalHz * 1000);
+}
+
+/**
+ * Encode a divider as P1/P2/P3 (AN619, section 3.2).
+ */
+constexpr Si5351Parameters si5351Encode(Si5351Divider divider) {
+    uint64_t scaled = 128ULL * divider.b / divider.c;
+    return Si5351Parameters{
+        (uint32_t)(128ULL * divider.a + scaled - 512),
+        (uint32_t)(128ULL * divider.b - divider.c * scaled),
+        divider.c
+    };
+}
+
+/**
+ * Lay out P1/P2/P3 as the 8 bytes of a PLL or MultiSynth register block.
+ *
+ * @param parameters The encoded divider.
+ * @param high Bits merged into the third byte above P1[17:16]
+ *             (R_DIV and DIVBY4 for MultiSynth blocks).
+ * @param out Destination for the 8 register values.
+ */
+constexpr void si5351Pack(Si5351Parameters parameters, uint8_t high, uint8_t *out) {
+    out[0] = (uint8_t)(parameters.p3 >> 8);
+    out[1] = (uint8_t)parameters.p3;
+    out[2] = (uint8_t)(high | ((parameters.p1 >> 16) & 0x03));
+    out[3] = (uint8_t)(parameters.p1 >> 8);
+    out[4] = (uint8_t)parameters.p1;
+    out[5] = (uint8_t)(((parameters.p3 >> 12) & 0xF0) | ((parameters.p2 >> 16) & 0x0F));
+    out[6] = (uint8_t)(parameters.p2 >> 8);
+    out[7] = (uint8_t)parameters.p2;
+}
+
+/**
+ * Read P1/P2/P3 back from an 8-byte PLL or MultiSynth register block.
+ */
+constexpr Si5351Parameters si5351Unpack(const uint8_t *block) {
+    return Si5351Parameters{
+        ((uint32_t)(block[2] & 0x03) << 16) | ((uint32_t)block[3] << 8) | block[4],
+        ((uint32_t)(block[5] & 0x0F) << 16) | ((uint32_t)block[6] << 8) | block[7],
+        ((uint32_t)(block[5] & 0xF0) << 12) | ((uint32_t)block[0] << 8) | block[1]
+    };
+}
+
+/**
+ * Divider value a + b/c represented by encoded parameters.
+ */
+constexpr double si5351DividerValue(Si5351Parameters parameters) {
+    return (parameters.p1 + 512 + (double)parameters.p2 / parameters.p3) / 128.0;
+}
+
+/**
+ * Solve the register image for CLK0 = outputMilliHz using an integer
+ * MultiSynth divider and a fractional PLL A feedback divider. When the
+ * exact feedback fraction needs a denominator above 2^20-1, the closest
+ * fraction that fits is used. An odd MultiSynth divider runs in
+ * fractional mode (MS0_INT clear).
+ *
+ * @param outputMilliHz The output frequency in millihertz.
+ * @param multiSynth The integer MultiSynth0 divider.
+ * @param xtalHz The reference frequency in hertz.
+ * @param rDividerLog2 The output R divider as a power of two (0 = divide by 1).
+ */
+constexpr Si5351RegisterImage si5351Solve(uint64_t outputMilliHz, uint32_t multiSynth, uint64_t xtalHz = SI5351_XTAL_FREQUENCY, uint8_t rDividerLog2 = 0) {
+    Si5351RegisterImage image{};
+
+    // MS0_INT is only allowed for even integer dividers
+    image.clockControl = (multiSynth & 1 ? 0 : SI5351_CLK_CONTROL_INTEGER_MODE) | SI5351_CLK_CONTROL_MULTISYNTH_8MA;
+    si5351Pack(si5351Encode(si5351FeedbackDivider((outputMilliHz << rDividerLog2) * multiSynth, xtalHz)), 0, image.pll);
+    si5351Pack(si5351Encode(Si5351Divider{ multiSynth, 0, 1 }), (uint8_t)(rDividerLog2 << 4), image.multiSynth);
+    return image;
+}
+
+/**
+ * Check a (frequency, MultiSynth) choice against the Si5351 limits.
+ */
+constexpr bool si5351VcoInRange(uint64_t outputMilliHz, uint32_t multiSynth) {
+    return outputMilliHz * multiSynth >= SI5351_VCO_MIN * 1000 && outputMilliHz * multiSynth <= SI5351_VCO_MAX * 1000;
+}
+
+/**
+ * A feedback divider of 15 to 90 inclusive; 90 itself only as an integer.
+ */
+constexpr bool si5351FeedbackDividerInRange(Si5351Divider divider) {
+    return divider.a >= SI5351_FEEDBACK_MIN && (divider.a < SI5351_FEEDBACK_MAX || (divider.a == SI5351_FEEDBACK_MAX && divider.b == 0));
+}
+
+constexpr bool si5351FeedbackInRange(uint64_t outputMilliHz, uint32_t multiSynth, uint64_t xtalHz = SI5351_XTAL_FREQUENCY) {
+    return si5351FeedbackDividerInRange(si5351FeedbackDivider(outputMilliHz * multiSynth, xtalHz));
+}
+
+constexpr bool si5351MultiSynthInRange(uint32_t multiSynth) {
+    return multiSynth >= SI5351_MULTISYNTH_MIN && multiSynth <= SI5351_MULTISYNTH_MAX;
+}
+
+/**
+ * Result of the runtime solver.
+ */
+struct Si5351Solution {
+    Si5351RegisterImage image;
+    Si5351Divider feedback;
+    uint32_t multiSynth;
+    uint8_t rDividerLog2;
+    double errorPpb;        // signed, (actual - target) / target
+};
+
+/**
+ * Solve any output frequency at run time. Unless multiSynth is given, every
+ * integer MultiSynth divider that keeps the VCO within 600-900 MHz is tried
+ * (even dividers first, nearest to a 700 MHz VCO first) and the one with the
+ * lowest error wins; the search stops early once the error is below
+ * 0.001 ppb.
+ *
+ * @param outputMilliHz The output frequency in millihertz.
+ * @param xtalHz The reference frequency in hertz.
+ * @param multiSynth A fixed MultiSynth0 divider, or 0 to search.
+ * @param solution Receives the register image and its error.
+ * @return 0 on success, -1 if the frequency cannot be produced.
+ */
+int si5351SolveFrequency(uint64_t outputMilliHz, uint64_t xtalHz, uint32_t multiSynth, Si5351Solution *solution);
+
+/**
+ * Parse a frequency in hertz with up to three decimals ("1789772.5").
+ *
+ * @return 0 on success, -1 if the text is not a frequency.
+ */
+int si5351ParseMilliHz(const char *text, uint64_t *milliHz);
+
+#endif // SI5351_SOLVER_H
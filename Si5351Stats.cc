@@ -0,0 +1,67 @@
+/*
+ * SI5351 bus statistics
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include "Si5351Stats.h"
+
+static const char *const PHASE_NAMES[SI5351_PHASE_COUNT] = {
+    "disable", "clock_control", "pll", "multisynth", "reset", "lock", "enable", "verify", "other"
+};
+
+uint64_t si5351WireBits(const struct i2c_msg *messages, int count) {
+    uint64_t bits = 1;
+    for (int i = 0; i < count; i++) {
+        bits += 1 + 9 * (1 + messages[i].len);
+    }
+    return bits;
+}
+
+static double wireMicroseconds(const Si5351PhaseStats &phase, uint32_t busHz) {
+    return busHz == 0 ? 0 : phase.wireBits * 1e6 / busHz;
+}
+
+static void printPhase(FILE *out, const char *name, const Si5351PhaseStats &phase, uint32_t busHz, bool json) {
+    if (json) {
+        fprintf(out, "\"%s\":{\"syscalls\":%u,\"transfers\":%u,\"messages\":%u,\"bytes\":%u,"
+                     "\"retries\":%u,\"failures\":%u,\"wall_us\":%.1f,\"wire_us\":%.1f}",
+                name, phase.syscalls, phase.transfers, phase.messages, phase.bytes,
+                phase.retries, phase.failures, phase.wallNs / 1000.0, wireMicroseconds(phase, busHz));
+    } else {
+        fprintf(out, "%-14s %8u %9u %8u %6u %7u %8u %10.1f %10.1f\n",
+                name, phase.syscalls, phase.transfers, phase.messages, phase.bytes,
+                phase.retries, phase.failures, phase.wallNs / 1000.0, wireMicroseconds(phase, busHz));
+    }
+}
+
+void si5351PrintStats(FILE *out, const Si5351BusStats &stats, bool json) {
+    if (json) {
+        fprintf(out, "{\"bus_hz\":%u,\"phases\":{", stats.busHz);
+    } else {
+        fprintf(out, "%-14s %8s %9s %8s %6s %7s %8s %10s %10s\n", "Phase", "Syscalls", "Transfers",
+                "Messages", "Bytes", "Retries", "Failures", "Wall (us)", "Wire (us)");
+    }
+
+    bool first = true;
+    for (int i = 0; i < SI5351_PHASE_COUNT; i++) {
+        if (stats.phases[i].transfers == 0) {
+            continue;
+        }
+        if (json && !first) {
+            fputc(',', out);
+        }
+        printPhase(out, PHASE_NAMES[i], stats.phases[i], stats.busHz, json);
+        first = false;
+    }
+
+    if (json) {
+        fputs("},", out);
+        printPhase(out, "total", stats.total, stats.busHz, true);
+        fputs("}\n", out);
+    } else {
+        printPhase(out, "total", stats.total, stats.busHz, false);
+        fprintf(out, "Wire time estimated at %u Hz.\n", stats.busHz);
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * SI5351 bus statistics
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Counters kept by Si5351Transport for every transfer, split by the
+ *   phase of the programming sequence each register block belongs to.
+ *   Several phases usually share one transfer (and even one message,
+ *   when their registers are contiguous). Such a transfer is counted in
+ *   every phase it touches and once in the total; its wall-clock time is
+ *   shared between the phases in proportion to their bits on the wire.
+ */
+
+#ifndef SI5351_STATS_H
+#define SI5351_STATS_H
+
+#include <linux/i2c.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define SI5351_PHASE_DISABLE 0
+#define SI5351_PHASE_CLOCK_CONTROL 1
+#define SI5351_PHASE_PLL 2
+#define SI5351_PHASE_MULTISYNTH 3
+#define SI5351_PHASE_RESET 4
+#define SI5351_PHASE_LOCK 5         // polling for PLL lock
+#define SI5351_PHASE_ENABLE 6
+#define SI5351_PHASE_VERIFY 7       // read-back and repair
+#define SI5351_PHASE_OTHER 8        // single writes and reads
+#define SI5351_PHASE_COUNT 9
+
+struct Si5351PhaseStats {
+    uint32_t syscalls;
+    uint32_t transfers;         // combined transfers, one STOP each
+    uint32_t messages;          // START or repeated START
+    uint32_t bytes;             // payload, register pointer included
+    uint32_t retries;
+    uint32_t failures;
+    uint64_t wireBits;          // on the wire, START/STOP and ACK included
+    uint64_t wallNs;
+};
+
+struct Si5351BusStats {
+    uint32_t busHz;             // for the on-wire estimate
+    Si5351PhaseStats phases[SI5351_PHASE_COUNT];
+    Si5351PhaseStats total;
+};
+
+/**
+ * Bits a combined transfer puts on the wire: one per (repeated) START and
+ * for the STOP, nine (eight plus ACK) per address and data byte.
+ */
+uint64_t si5351WireBits(const struct i2c_msg *messages, int count);
+
+/**
+ * Print the statistics as a table, or as one line of JSON.
+ *
+ * @param out The stream to print to.
+ * @param stats The counters to print.
+ * @param json Print JSON instead of the table.
+ */
+void si5351PrintStats(FILE *out, const Si5351BusStats &stats, bool json);
+
+#endif // SI5351_STATS_H
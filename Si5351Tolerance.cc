@@ -0,0 +1,280 @@
+/*
+ * SI5351 crystal tolerance and drift analysis
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <thread>
+
+#include "Si5351Tolerance.h"
+#include "Si5351Transport.h"
+
+// Independent accumulators per image, one vector register wide with AVX
+#define LANES 4
+
+/**
+ * What one image contributes per ppm of crystal deviation.
+ */
+struct Model {
+    double slope;               // output error in ppm per ppm of deviation
+    double offset;              // output error in ppm at zero deviation
+    double vcoHz;               // at zero deviation
+};
+
+struct Accumulator {
+    double min;                 // of the error minus the model offset
+    double max;
+    double sum;
+    double sumSquares;
+    uint64_t within;
+    uint64_t violations;
+};
+
+struct Worker {
+    uint64_t begin;
+    uint64_t end;
+    double deviationMin;
+    double deviationMax;
+    Accumulator accumulators[SI5351_TOLERANCE_MAX_TARGETS];
+    uint64_t histogram[SI5351_TOLERANCE_BINS];
+};
+
+struct Job {
+    const Si5351ToleranceOptions *options;
+    const Model *models;
+    int count;
+    uint64_t side;              // grid points per axis, 0 for Monte Carlo
+    double range;               // largest deviation, ppm
+};
+
+/**
+ * SplitMix64: a counter-based generator, so sample i is the same on any thread.
+ */
+static uint64_t splitMix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * Uniform in [-1, 1) from 53 random bits.
+ */
+static double uniform(uint64_t bits) {
+    return (double)(bits >> 11) * (2.0 / 9007199254740992.0) - 1;
+}
+
+/**
+ * Exact divider values of an image, as the output and VCO per hertz of crystal.
+ */
+static Model modelOf(const Si5351ToleranceTarget &target) {
+    const uint8_t *multiSynth = target.image.multiSynth;
+    double feedback = si5351DividerValue(si5351Unpack(target.image.pll));
+    double divider = (multiSynth[2] & 0x0C) == 0x0C ? 4 : si5351DividerValue(si5351Unpack(multiSynth));
+    double outputHz = SI5351_XTAL_FREQUENCY * feedback / divider / (1 << ((multiSynth[2] >> 4) & 0x07));
+    double scale = outputHz / (target.outputMilliHz / 1000.0);
+    return Model{ scale, (scale - 1) * 1e6, SI5351_XTAL_FREQUENCY * feedback };
+}
+
+static void work(const Job *job, Worker *worker) {
+    const Si5351ToleranceOptions &options = *job->options;
+    double deviation[SI5351_TOLERANCE_BLOCK];
+    double binsPerPpm = job->range > 0 ? SI5351_TOLERANCE_BINS / (2 * job->range) : 0;
+
+    worker->deviationMin = INFINITY;
+    worker->deviationMax = -INFINITY;
+    memset(worker->histogram, 0, sizeof(worker->histogram));
+    for (int t = 0; t < job->count; t++) {
+        worker->accumulators[t] = Accumulator{ INFINITY, -INFINITY, 0, 0, 0, 0 };
+    }
+
+    for (uint64_t first = worker->begin; first < worker->end; first += SI5351_TOLERANCE_BLOCK) {
+        int length = (int)(worker->end - first < SI5351_TOLERANCE_BLOCK ? worker->end - first : SI5351_TOLERANCE_BLOCK);
+
+        // Tolerance and drift of each sample
+        for (int k = 0; k < length; k++) {
+            uint64_t index = first + k;
+            double tolerance, drift;
+            if (job->side > 0) {
+                double step = job->side > 1 ? 2.0 / (job->side - 1) : 0;
+                tolerance = job->side > 1 ? (double)(index / job->side) * step - 1 : 0;
+                drift = job->side > 1 ? (double)(index % job->side) * step - 1 : 0;
+            } else {
+                tolerance = uniform(splitMix(options.seed + 2 * index));
+                drift = uniform(splitMix(options.seed + 2 * index + 1));
+            }
+            deviation[k] = tolerance * options.tolerancePpm + drift * options.driftPpm;
+        }
+        for (int k = 0; k < length; k++) {
+            int bin = (int)((deviation[k] + job->range) * binsPerPpm);
+            worker->histogram[bin < 0 ? 0 : bin >= SI5351_TOLERANCE_BINS ? SI5351_TOLERANCE_BINS - 1 : bin]++;
+            worker->deviationMin = deviation[k] < worker->deviationMin ? deviation[k] : worker->deviationMin;
+            worker->deviationMax = deviation[k] > worker->deviationMax ? deviation[k] : worker->deviationMax;
+        }
+
+        // The whole block for each image, in independent lanes so that the
+        // sums vectorize without reassociating floating-point additions
+        for (int t = 0; t < job->count; t++) {
+            const Model &model = job->models[t];
+            Accumulator &accumulator = worker->accumulators[t];
+            double vcoPerPpm = model.vcoHz * 1e-6;
+            double min[LANES], max[LANES], sum[LANES], sumSquares[LANES];
+            double within[LANES], violations[LANES];     // exact up to 2^53 samples
+            for (int l = 0; l < LANES; l++) {
+                min[l] = accumulator.min;
+                max[l] = accumulator.max;
+                sum[l] = sumSquares[l] = 0;
+                within[l] = violations[l] = 0;
+            }
+            int k = 0;
+            for (; k + LANES <= length; k += LANES) {
+                for (int l = 0; l < LANES; l++) {
+                    double error = model.slope * deviation[k + l];
+                    double vcoHz = model.vcoHz + vcoPerPpm * deviation[k + l];
+                    min[l] = error < min[l] ? error : min[l];
+                    max[l] = error > max[l] ? error : max[l];
+                    sum[l] += error;
+                    sumSquares[l] += error * error;
+                    within[l] += fabs(error + model.offset) <= options.limitPpm ? 1.0 : 0.0;
+                    violations[l] += vcoHz < SI5351_VCO_MIN || vcoHz > SI5351_VCO_MAX ? 1.0 : 0.0;
+                }
+            }
+            for (int l = 0; k < length; k++, l++) {
+                double error = model.slope * deviation[k];
+                double vcoHz = model.vcoHz + vcoPerPpm * deviation[k];
+                min[l] = error < min[l] ? error : min[l];
+                max[l] = error > max[l] ? error : max[l];
+                sum[l] += error;
+                sumSquares[l] += error * error;
+                within[l] += fabs(error + model.offset) <= options.limitPpm ? 1.0 : 0.0;
+                violations[l] += vcoHz < SI5351_VCO_MIN || vcoHz > SI5351_VCO_MAX ? 1.0 : 0.0;
+            }
+            for (int l = 0; l < LANES; l++) {
+                accumulator.min = min[l] < accumulator.min ? min[l] : accumulator.min;
+                accumulator.max = max[l] > accumulator.max ? max[l] : accumulator.max;
+                accumulator.sum += sum[l];
+                accumulator.sumSquares += sumSquares[l];
+                accumulator.within += (uint64_t)within[l];
+                accumulator.violations += (uint64_t)violations[l];
+            }
+        }
+    }
+}
+
+/**
+ * Deviation below which a fraction of the samples lie, to the bin centre.
+ */
+static double percentile(const uint64_t *histogram, uint64_t samples, double range, double fraction) {
+    uint64_t wanted = (uint64_t)ceil(fraction * samples);
+    uint64_t seen = 0;
+    int bin = 0;
+    while (bin < SI5351_TOLERANCE_BINS - 1 && seen + histogram[bin] < wanted) {
+        seen += histogram[bin++];
+    }
+    return range > 0 ? -range + (bin + 0.5) * (2 * range / SI5351_TOLERANCE_BINS) : 0;
+}
+
+int si5351AnalyzeTolerance(const Si5351ToleranceTarget *targets, int count, const Si5351ToleranceOptions &options,
+                           Si5351Tolerance *tolerance) {
+    static Worker workers[SI5351_TOLERANCE_MAX_THREADS];
+    static uint64_t histogram[SI5351_TOLERANCE_BINS];
+    Model models[SI5351_TOLERANCE_MAX_TARGETS];
+    uint64_t start = monotonicNs();
+
+    if (count < 1 || count > SI5351_TOLERANCE_MAX_TARGETS || options.samples == 0 || options.tolerancePpm < 0 ||
+        options.driftPpm < 0) {
+        return -1;
+    }
+    for (int t = 0; t < count; t++) {
+        models[t] = modelOf(targets[t]);
+    }
+
+    Job job = { &options, models, count, 0, options.tolerancePpm + options.driftPpm };
+    uint64_t samples = options.samples;
+    if (options.grid) {
+        job.side = (uint64_t)sqrt((double)samples);
+        while ((job.side + 1) * (job.side + 1) <= samples) {
+            job.side++;
+        }
+        while (job.side * job.side > samples) {
+            job.side--;
+        }
+        samples = job.side * job.side;
+    }
+
+    int threads = options.threads;
+    if (threads <= 0) {
+        threads = (int)std::thread::hardware_concurrency();
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > SI5351_TOLERANCE_MAX_THREADS) {
+        threads = SI5351_TOLERANCE_MAX_THREADS;
+    }
+    for (int i = 0; i < threads; i++) {
+        workers[i].begin = samples * i / threads;
+        workers[i].end = samples * (i + 1) / threads;
+    }
+
+    std::thread pool[SI5351_TOLERANCE_MAX_THREADS];
+    for (int i = 1; i < threads; i++) {
+        pool[i] = std::thread(work, &job, &workers[i]);
+    }
+    work(&job, &workers[0]);
+    for (int i = 1; i < threads; i++) {
+        pool[i].join();
+    }
+
+    memset(histogram, 0, sizeof(histogram));
+    for (int i = 0; i < threads; i++) {
+        for (int bin = 0; bin < SI5351_TOLERANCE_BINS; bin++) {
+            histogram[bin] += workers[i].histogram[bin];
+        }
+    }
+    double p1 = percentile(histogram, samples, job.range, 0.01);
+    double p50 = percentile(histogram, samples, job.range, 0.50);
+    double p99 = percentile(histogram, samples, job.range, 0.99);
+
+    tolerance->count = count;
+    for (int t = 0; t < count; t++) {
+        const Model &model = models[t];
+        Accumulator total = { INFINITY, -INFINITY, 0, 0, 0, 0 };
+        double deviationMin = INFINITY, deviationMax = -INFINITY;
+        for (int i = 0; i < threads; i++) {
+            const Accumulator &accumulator = workers[i].accumulators[t];
+            total.min = accumulator.min < total.min ? accumulator.min : total.min;
+            total.max = accumulator.max > total.max ? accumulator.max : total.max;
+            total.sum += accumulator.sum;
+            total.sumSquares += accumulator.sumSquares;
+            total.within += accumulator.within;
+            total.violations += accumulator.violations;
+            deviationMin = workers[i].deviationMin < deviationMin ? workers[i].deviationMin : deviationMin;
+            deviationMax = workers[i].deviationMax > deviationMax ? workers[i].deviationMax : deviationMax;
+        }
+
+        Si5351ToleranceResult &result = tolerance->results[t];
+        double mean = total.sum / samples;
+        double variance = total.sumSquares / samples - mean * mean;
+        result.nominalPpb = model.offset * 1000;
+        result.minPpm = total.min + model.offset;
+        result.maxPpm = total.max + model.offset;
+        result.meanPpm = mean + model.offset;
+        result.stddevPpm = variance > 0 ? sqrt(variance) : 0;
+        result.p1Ppm = model.slope * p1 + model.offset;
+        result.p50Ppm = model.slope * p50 + model.offset;
+        result.p99Ppm = model.slope * p99 + model.offset;
+        result.withinLimit = options.limitPpm > 0 ? (double)total.within / samples : 0;
+        result.vcoMinMHz = model.vcoHz * (1 + deviationMin * 1e-6) / 1e6;
+        result.vcoMaxMHz = model.vcoHz * (1 + deviationMax * 1e-6) / 1e6;
+        result.vcoViolations = total.violations;
+    }
+    tolerance->samples = samples;
+    tolerance->threads = threads;
+    tolerance->elapsedNs = monotonicNs() - start;
+    return 0;
+}
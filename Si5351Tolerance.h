@@ -0,0 +1,102 @@
+/*
+ * SI5351 crystal tolerance and drift analysis
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   How far the output of a register image moves when the crystal is not
+ *   exactly 25 MHz. The crystal deviation of a sample is an initial
+ *   tolerance plus a temperature drift, each uniform within its bound,
+ *   taken either as a Monte Carlo sample or as a square grid over both
+ *   ranges. For every sample and register image the output follows from
+ *   the exact divider values in the registers:
+ *
+ *     output = xtal * (1 + deviation) * feedback / MultiSynth / R
+ *
+ *   and is compared with the image's target frequency. The VCO of every
+ *   sample is checked against 600-900 MHz.
+ *
+ *   Samples are generated in blocks of SI5351_TOLERANCE_BLOCK deviations
+ *   and each block is evaluated for every image in a branch-free loop
+ *   with four independent accumulators, which the compiler vectorizes
+ *   without reordering floating-point sums. The sample range is split
+ *   evenly across worker threads. Monte Carlo sample i comes from a
+ *   counter-based generator seeded with i, so the samples do not depend
+ *   on the thread count. Percentiles come from a histogram of the deviation, since the
+ *   output error rises monotonically with it.
+ */
+
+#ifndef SI5351_TOLERANCE_H
+#define SI5351_TOLERANCE_H
+
+#include <stdint.h>
+
+#include "Si5351Solver.h"
+
+#define SI5351_TOLERANCE_PPM 30.0
+#define SI5351_TOLERANCE_DRIFT_PPM 10.0
+#define SI5351_TOLERANCE_SAMPLES 1000000
+#define SI5351_TOLERANCE_MAX_TARGETS 64
+#define SI5351_TOLERANCE_MAX_THREADS 64
+#define SI5351_TOLERANCE_BLOCK 512
+#define SI5351_TOLERANCE_BINS 4096
+
+struct Si5351ToleranceOptions {
+    double tolerancePpm;        // initial crystal tolerance, +-
+    double driftPpm;            // over temperature, +-
+    uint64_t samples;           // a grid uses the largest square not above this
+    bool grid;                  // a grid instead of Monte Carlo samples
+    double limitPpm;            // count samples within +-limit of the target, 0 = do not
+    uint64_t seed;
+    int threads;                // 0 = one per core
+};
+
+/**
+ * A register image and the frequency it is meant to produce.
+ */
+struct Si5351ToleranceTarget {
+    const char *name;
+    uint64_t outputMilliHz;
+    Si5351RegisterImage image;
+};
+
+/**
+ * Output error statistics of one register image, in ppm of its target.
+ */
+struct Si5351ToleranceResult {
+    double nominalPpb;          // with an exact 25 MHz crystal
+    double minPpm;
+    double maxPpm;
+    double meanPpm;
+    double stddevPpm;
+    double p1Ppm;               // percentiles, to the histogram resolution
+    double p50Ppm;
+    double p99Ppm;
+    double withinLimit;         // fraction of samples, if a limit was given
+    double vcoMinMHz;
+    double vcoMaxMHz;
+    uint64_t vcoViolations;     // samples with the VCO outside 600-900 MHz
+};
+
+struct Si5351Tolerance {
+    int count;
+    Si5351ToleranceResult results[SI5351_TOLERANCE_MAX_TARGETS];
+    uint64_t samples;
+    int threads;
+    uint64_t elapsedNs;
+};
+
+/**
+ * Evaluate register images over crystal deviations.
+ *
+ * @param targets The images to analyse.
+ * @param count How many, at most SI5351_TOLERANCE_MAX_TARGETS.
+ * @param options The deviation model and sample count.
+ * @param tolerance Receives one result per target, in the same order.
+ * @return 0 on success, -1 on invalid options or too many targets.
+ */
+int si5351AnalyzeTolerance(const Si5351ToleranceTarget *targets, int count, const Si5351ToleranceOptions &options,
+                           Si5351Tolerance *tolerance);
+
+#endif // SI5351_TOLERANCE_H
@@ -0,0 +1,184 @@
+/*
+ * SI5351 bus trace
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Si5351Trace.h"
+
+static uint64_t clockNs(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * Copy into the ring at position, wrapping at the end.
+ *
+ * @return The position after the copy.
+ */
+static uint32_t put(Si5351Trace *trace, uint32_t position, const void *data, uint32_t length) {
+    uint32_t first = trace->capacity - position < length ? trace->capacity - position : length;
+    memcpy(trace->buffer + position, data, first);
+    memcpy(trace->buffer, (const uint8_t *)data + first, length - first);
+    return (position + length) % trace->capacity;
+}
+
+static uint16_t recordSize(const Si5351Trace &trace, uint32_t position) {
+    return trace.buffer[position] | trace.buffer[(position + 1) % trace.capacity] << 8;
+}
+
+static void putLittleEndian(uint8_t *bytes, uint64_t value, int length) {
+    for (int i = 0; i < length; i++) {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint64_t getLittleEndian(const uint8_t *bytes, int length) {
+    uint64_t value = 0;
+    for (int i = 0; i < length; i++) {
+        value |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+void si5351TraceInit(Si5351Trace *trace, uint8_t *buffer, uint32_t capacity) {
+    memset(trace, 0, sizeof(*trace));
+    trace->buffer = buffer;
+    trace->capacity = capacity;
+    trace->startNs = clockNs(CLOCK_MONOTONIC);
+    trace->startRealtimeNs = clockNs(CLOCK_REALTIME);
+}
+
+void si5351TraceTransfer(Si5351Trace *trace, uint64_t startNs, uint64_t endNs, const struct i2c_msg *messages, int count,
+                         int attempts, int result) {
+    uint32_t size = SI5351_TRACE_RECORD_HEADER;
+    for (int i = 0; i < count; i++) {
+        size += 3 + messages[i].len;
+    }
+    if (size > trace->capacity || size > UINT16_MAX || count > SI5351_TRACE_MAX_MESSAGES) {
+        trace->dropped++;
+        return;
+    }
+
+    // Make room at the old end
+    while (trace->capacity - trace->used < size) {
+        uint16_t oldest = recordSize(*trace, trace->tail);
+        trace->tail = (trace->tail + oldest) % trace->capacity;
+        trace->used -= oldest;
+        trace->records--;
+        trace->dropped++;
+    }
+
+    uint8_t header[SI5351_TRACE_RECORD_HEADER];
+    putLittleEndian(header, size, 2);
+    putLittleEndian(header + 2, startNs - trace->startNs, 8);
+    putLittleEndian(header + 10, endNs - startNs, 4);
+    header[14] = (uint8_t)attempts;
+    header[15] = result == -1 ? SI5351_TRACE_FAILED : 0;
+    header[16] = (uint8_t)count;
+    uint32_t position = put(trace, trace->head, header, sizeof(header));
+    for (int i = 0; i < count; i++) {
+        const uint8_t message[3] = { (uint8_t)messages[i].addr, (uint8_t)(messages[i].flags & I2C_M_RD), (uint8_t)messages[i].len };
+        position = put(trace, position, message, sizeof(message));
+        position = put(trace, position, messages[i].buf, messages[i].len);
+    }
+    trace->head = position;
+    trace->used += size;
+    trace->records++;
+}
+
+int si5351SaveTrace(const Si5351Trace &trace, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) {
+        perror("Failed to create the trace");
+        return -1;
+    }
+
+    Si5351TraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SI5351_TRACE_MAGIC, sizeof(header.magic));
+    header.version = SI5351_TRACE_VERSION;
+    header.records = trace.records;
+    header.dropped = trace.dropped;
+    header.startRealtimeNs = trace.startRealtimeNs;
+    header.size = trace.used;
+
+    // The records, unwrapped
+    uint32_t first = trace.capacity - trace.tail < trace.used ? trace.capacity - trace.tail : trace.used;
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(trace.buffer + trace.tail, 1, first, file) == first &&
+                   fwrite(trace.buffer, 1, trace.used - first, file) == trace.used - first;
+    if (fclose(file) != 0 || !written) {
+        perror("Failed to write the trace");
+        return -1;
+    }
+    return 0;
+}
+
+int si5351LoadTrace(const char *path, Si5351TraceFile *file) {
+    FILE *in = fopen(path, "rb");
+    if (in == nullptr) {
+        perror("Failed to open the trace");
+        return -1;
+    }
+
+    file->data = nullptr;
+    bool valid = fread(&file->header, sizeof(file->header), 1, in) == 1 &&
+                 memcmp(file->header.magic, SI5351_TRACE_MAGIC, sizeof(file->header.magic)) == 0 &&
+                 file->header.version == SI5351_TRACE_VERSION;
+    if (valid) {
+        file->data = (uint8_t *)malloc(file->header.size + 1);
+        valid = file->data != nullptr && fread(file->data, 1, file->header.size, in) == file->header.size;
+    }
+    fclose(in);
+    if (!valid) {
+        fprintf(stderr, "%s: not a trace file, or truncated\n", path);
+        si5351FreeTrace(file);
+        return -1;
+    }
+    return 0;
+}
+
+void si5351FreeTrace(Si5351TraceFile *file) {
+    free(file->data);
+    file->data = nullptr;
+}
+
+int si5351NextTraceEntry(const Si5351TraceFile &file, uint64_t *offset, Si5351TraceEntry *entry) {
+    uint64_t left = file.header.size - *offset;
+    if (left == 0) {
+        return 0;
+    }
+
+    const uint8_t *record = file.data + *offset;
+    uint16_t size = left >= SI5351_TRACE_RECORD_HEADER ? (uint16_t)getLittleEndian(record, 2) : 0;
+    if (size < SI5351_TRACE_RECORD_HEADER || size > left || record[16] > SI5351_TRACE_MAX_MESSAGES) {
+        return -1;
+    }
+    entry->timeNs = getLittleEndian(record + 2, 8);
+    entry->durationNs = (uint32_t)getLittleEndian(record + 10, 4);
+    entry->attempts = record[14];
+    entry->failed = record[15] & SI5351_TRACE_FAILED;
+    entry->messageCount = record[16];
+
+    const uint8_t *next = record + SI5351_TRACE_RECORD_HEADER;
+    for (int i = 0; i < entry->messageCount; i++) {
+        if (next + 3 > record + size || next + 3 + next[2] > record + size) {
+            return -1;
+        }
+        entry->messages[i].address = next[0];
+        entry->messages[i].read = next[1] & I2C_M_RD;
+        entry->messages[i].length = next[2];
+        entry->messages[i].data = next + 3;
+        next += 3 + next[2];
+    }
+    *offset += size;
+    return 1;
+}
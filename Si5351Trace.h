@@ -0,0 +1,138 @@
+/*
+ * SI5351 bus trace
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   A record of every combined transfer a Si5351Transport makes, kept in
+ *   a fixed ring buffer so that it can stay on in the field: once the
+ *   buffer is full the oldest transfers are dropped. A transport without
+ *   a trace pays one pointer test per transfer. Each record holds, in
+ *   little-endian byte order:
+ *
+ *     uint16 size          of the whole record
+ *     uint64 time          start of the transfer, ns from the trace start
+ *     uint32 duration      ns, retries included
+ *     uint8  attempts
+ *     uint8  flags         SI5351_TRACE_FAILED
+ *     uint8  messages
+ *     per message: uint8 address, uint8 flags (I2C_M_RD), uint8 length
+ *                  and the bytes written (register pointer first) or read
+ *
+ *   A trace file is the header below followed by the records, oldest
+ *   first. The si5351_trace tool prints it, converts it to Chrome
+ *   trace-event JSON and replays it.
+ */
+
+#ifndef SI5351_TRACE_H
+#define SI5351_TRACE_H
+
+#include <linux/i2c.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SI5351_TRACE_MAGIC "S5TR"
+#define SI5351_TRACE_VERSION 1
+#define SI5351_TRACE_SIZE (64 * 1024)
+#define SI5351_TRACE_MAX_MESSAGES 8
+#define SI5351_TRACE_RECORD_HEADER 17
+
+// Record flags
+#define SI5351_TRACE_FAILED 0x01
+
+struct Si5351TraceHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t records;
+    uint32_t dropped;           // overwritten before the trace was saved
+    uint64_t startRealtimeNs;   // CLOCK_REALTIME at the trace start
+    uint64_t size;              // bytes of records that follow
+};
+
+/**
+ * The ring buffer being recorded into.
+ */
+struct Si5351Trace {
+    uint8_t *buffer;
+    uint32_t capacity;
+    uint32_t head;              // where the next record goes
+    uint32_t tail;              // the oldest record
+    uint32_t used;
+    uint32_t records;
+    uint32_t dropped;
+    uint64_t startNs;           // CLOCK_MONOTONIC
+    uint64_t startRealtimeNs;
+};
+
+/**
+ * One message of a decoded record.
+ */
+struct Si5351TraceMessage {
+    uint8_t address;
+    bool read;
+    uint8_t length;
+    const uint8_t *data;
+};
+
+/**
+ * A decoded record.
+ */
+struct Si5351TraceEntry {
+    uint64_t timeNs;
+    uint32_t durationNs;
+    uint8_t attempts;
+    bool failed;
+    int messageCount;
+    Si5351TraceMessage messages[SI5351_TRACE_MAX_MESSAGES];
+};
+
+/**
+ * A trace file read into memory.
+ */
+struct Si5351TraceFile {
+    Si5351TraceHeader header;
+    uint8_t *data;
+};
+
+/**
+ * Start a trace in the given buffer.
+ */
+void si5351TraceInit(Si5351Trace *trace, uint8_t *buffer, uint32_t capacity);
+
+/**
+ * Record one transfer, dropping the oldest records if there is no room.
+ *
+ * @param startNs CLOCK_MONOTONIC time the transfer started.
+ * @param endNs CLOCK_MONOTONIC time it finished.
+ * @param attempts How many times it was tried.
+ * @param result The result of the last attempt, 0 or -1.
+ */
+void si5351TraceTransfer(Si5351Trace *trace, uint64_t startNs, uint64_t endNs, const struct i2c_msg *messages, int count,
+                         int attempts, int result);
+
+/**
+ * Write the trace to a file, oldest record first.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int si5351SaveTrace(const Si5351Trace &trace, const char *path);
+
+/**
+ * Read a trace file and check its header.
+ *
+ * @return 0 on success, -1 if the file is missing or invalid.
+ */
+int si5351LoadTrace(const char *path, Si5351TraceFile *file);
+
+void si5351FreeTrace(Si5351TraceFile *file);
+
+/**
+ * Decode the record at offset and advance offset past it.
+ *
+ * @return 1 if a record was decoded, 0 at the end, -1 if the record is corrupt.
+ */
+int si5351NextTraceEntry(const Si5351TraceFile &file, uint64_t *offset, Si5351TraceEntry *entry);
+
+#endif // SI5351_TRACE_H
@@ -0,0 +1,266 @@
+/*
+ * SI5351 bus trace tool
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Works on the trace files written by Si5351ForAtari8bit --trace:
+ *
+ *     dump      one line per transfer: time, duration, result, messages
+ *     json      Chrome trace-event JSON, one complete event per transfer,
+ *               for chrome://tracing or ui.perfetto.dev
+ *     replay    issue the transfers again, in order, against the I2C bus
+ *               or the simulator; writes are sent as captured, reads are
+ *               compared with the captured data
+ *
+ *   Replay keeps the captured timing by default: every transfer starts at
+ *   its captured offset from the first one, divided by the speed factor.
+ *   A speed of 0 sends the transfers back to back.
+ *
+ *   Usage: si5351_trace dump <trace>
+ *          si5351_trace json <trace> [output]
+ *          si5351_trace replay [--simulate] [--bus-speed <Hz>] [--speed <factor>] <trace>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Si5351Simulator.h"
+#include "Si5351Trace.h"
+#include "Si5351Transport.h"
+
+/**
+ * Short name of a transfer, e.g. "W3 W16-33 W177" or "R0-1": the
+ * register range of every write, and of every read after its pointer.
+ */
+static void describe(const Si5351TraceEntry &entry, char *text, size_t size) {
+    size_t length = 0;
+    int pointer = 0;
+    text[0] = '\0';
+    for (int i = 0; i < entry.messageCount && length < size; i++) {
+        const Si5351TraceMessage &message = entry.messages[i];
+        const char *separator = length == 0 ? "" : " ";
+        if (message.read) {
+            length += snprintf(text + length, size - length, message.length == 1 ? "%sR%d" : "%sR%d-%d", separator, pointer,
+                               pointer + message.length - 1);
+            pointer += message.length;
+        } else if (message.length == 1 && i + 1 < entry.messageCount && entry.messages[i + 1].read) {
+            pointer = message.data[0];      // register pointer for the read that follows
+        } else if (message.length > 0) {
+            pointer = message.data[0] + message.length - 1;
+            length += snprintf(text + length, size - length, message.length == 2 ? "%sW%d" : "%sW%d-%d", separator,
+                               message.data[0], pointer - 1);
+        }
+    }
+}
+
+/**
+ * The bytes of a message in hex, separated by blanks.
+ */
+static void hexBytes(const Si5351TraceMessage &message, char *text, size_t size) {
+    size_t length = 0;
+    text[0] = '\0';
+    for (int i = 0; i < message.length && length + 3 < size; i++) {
+        length += snprintf(text + length, size - length, i == 0 ? "%02X" : " %02X", message.data[i]);
+    }
+}
+
+static int dump(const Si5351TraceFile &file) {
+    Si5351TraceEntry entry;
+    uint64_t offset = 0;
+    int result;
+    char name[128];
+    char bytes[3 * (I2C_MAX_BURST + 1) + 1];
+
+    printf("%u transfers, %u dropped before saving\n", file.header.records, file.header.dropped);
+    while ((result = si5351NextTraceEntry(file, &offset, &entry)) == 1) {
+        describe(entry, name, sizeof(name));
+        printf("%12.3f ms %9.1f us %-6s %s\n", entry.timeNs / 1e6, entry.durationNs / 1e3,
+               entry.failed ? "FAILED" : entry.attempts > 1 ? "retry" : "ok", name);
+        for (int i = 0; i < entry.messageCount; i++) {
+            const Si5351TraceMessage &message = entry.messages[i];
+            hexBytes(message, bytes, sizeof(bytes));
+            printf("%30s %c %02Xh: %s\n", "", message.read ? 'R' : 'W', message.address, bytes);
+        }
+    }
+    return result == -1 ? 1 : 0;
+}
+
+static int exportJson(const Si5351TraceFile &file, const char *path) {
+    FILE *out = path != nullptr ? fopen(path, "w") : stdout;
+    if (out == nullptr) {
+        perror("Failed to create the output file");
+        return 1;
+    }
+
+    Si5351TraceEntry entry;
+    uint64_t offset = 0;
+    int result;
+    char name[128];
+    char bytes[3 * (I2C_MAX_BURST + 1) + 1];
+
+    fprintf(out, "{\"displayTimeUnit\": \"ns\", \"otherData\": {\"start_realtime_ns\": %llu, \"dropped\": %u},\n",
+            (unsigned long long)file.header.startRealtimeNs, file.header.dropped);
+    fprintf(out, " \"traceEvents\": [\n");
+    bool first = true;
+    while ((result = si5351NextTraceEntry(file, &offset, &entry)) == 1) {
+        describe(entry, name, sizeof(name));
+        fprintf(out, "%s  {\"name\": \"%s\", \"cat\": \"i2c\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, "
+                     "\"args\": {\"result\": \"%s\", \"attempts\": %u, \"messages\": [",
+                first ? "" : ",\n", name, entry.messageCount > 0 ? entry.messages[0].address : 0, entry.timeNs / 1e3,
+                entry.durationNs / 1e3, entry.failed ? "failed" : "ok", entry.attempts);
+        for (int i = 0; i < entry.messageCount; i++) {
+            hexBytes(entry.messages[i], bytes, sizeof(bytes));
+            fprintf(out, "%s\"%c %s\"", i == 0 ? "" : ", ", entry.messages[i].read ? 'R' : 'W', bytes);
+        }
+        fprintf(out, "]}}");
+        first = false;
+    }
+    fprintf(out, "\n ]}\n");
+    if (out != stdout) {
+        fclose(out);
+    }
+    return result == -1 ? 1 : 0;
+}
+
+static int replay(const Si5351TraceFile &file, Si5351Transport *transport, double speed) {
+    static uint8_t buffers[SI5351_TRACE_MAX_MESSAGES][I2C_MAX_BURST + 1];
+    struct i2c_msg messages[SI5351_TRACE_MAX_MESSAGES];
+    Si5351TraceEntry entry;
+    uint64_t offset = 0;
+    uint64_t firstNs = 0;
+    uint64_t startNs = 0;
+    uint64_t maxLateNs = 0;
+    uint64_t totalLateNs = 0;
+    uint32_t transfers = 0;
+    uint32_t failures = 0;
+    uint32_t differing = 0;
+    int result;
+
+    while ((result = si5351NextTraceEntry(file, &offset, &entry)) == 1) {
+        if (transfers == 0) {
+            firstNs = entry.timeNs;
+            startNs = monotonicNs();
+        }
+
+        // Wait for the captured offset, scaled
+        if (speed > 0) {
+            uint64_t due = startNs + (uint64_t)((entry.timeNs - firstNs) / speed);
+            struct timespec until;
+            until.tv_sec = due / 1000000000ULL;
+            until.tv_nsec = due % 1000000000ULL;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr);
+            uint64_t late = monotonicNs() - due;
+            totalLateNs += late;
+            maxLateNs = late > maxLateNs ? late : maxLateNs;
+        }
+
+        for (int i = 0; i < entry.messageCount; i++) {
+            const Si5351TraceMessage &message = entry.messages[i];
+            messages[i].addr = message.address;
+            messages[i].flags = message.read ? I2C_M_RD : 0;
+            messages[i].len = message.length;
+            messages[i].buf = buffers[i];
+            memcpy(buffers[i], message.data, message.length);
+        }
+        transfers++;
+        if (transport->transfer(messages, entry.messageCount) == -1) {
+            failures++;
+            continue;
+        }
+
+        // Reads of a captured failure hold nothing worth comparing
+        for (int i = 0; i < entry.messageCount && !entry.failed; i++) {
+            if (entry.messages[i].read && memcmp(buffers[i], entry.messages[i].data, entry.messages[i].length) != 0) {
+                char name[128];
+                char captured[3 * (I2C_MAX_BURST + 1) + 1];
+                char read[3 * (I2C_MAX_BURST + 1) + 1];
+                Si5351TraceMessage now = entry.messages[i];
+                now.data = buffers[i];
+                describe(entry, name, sizeof(name));
+                hexBytes(entry.messages[i], captured, sizeof(captured));
+                hexBytes(now, read, sizeof(read));
+                printf("%12.3f ms %s: captured %s, read %s\n", entry.timeNs / 1e6, name, captured, read);
+                differing++;
+            }
+        }
+    }
+
+    printf("Replayed %u transfers in %.1f ms: %u failed, %u reads differ", transfers,
+           transfers > 0 ? (monotonicNs() - startNs) / 1e6 : 0.0, failures, differing);
+    if (speed > 0 && transfers > 0) {
+        printf(", start late by %.1f us mean, %.1f us max", totalLateNs / 1e3 / transfers, maxLateNs / 1e3);
+    }
+    printf("\n");
+    return result == -1 || failures > 0 ? 1 : 0;
+}
+
+static void printUsage(const char *program) {
+    fprintf(stderr, "Usage: %s dump <trace>\n", program);
+    fprintf(stderr, "       %s json <trace> [output]\n", program);
+    fprintf(stderr, "       %s replay [--simulate] [--bus-speed <Hz>] [--speed <factor>] <trace>\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    const char *command = argc > 1 ? argv[1] : "";
+    const char *path = nullptr;
+    const char *output = nullptr;
+    bool simulate = false;
+    uint32_t busHz = 100000;
+    double speed = 1;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--simulate") == 0) {
+            simulate = true;
+        } else if (strcmp(argv[i], "--bus-speed") == 0 && i + 1 < argc) {
+            busHz = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = atof(argv[++i]);
+        } else if (path == nullptr) {
+            path = argv[i];
+        } else if (output == nullptr) {
+            output = argv[i];
+        } else {
+            path = nullptr;
+            break;
+        }
+    }
+    bool replaying = strcmp(command, "replay") == 0;
+    if (path == nullptr || speed < 0 || (strcmp(command, "dump") != 0 && strcmp(command, "json") != 0 && !replaying) ||
+        (output != nullptr && strcmp(command, "json") != 0)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Si5351TraceFile file;
+    if (si5351LoadTrace(path, &file) == -1) {
+        return 1;
+    }
+
+    int result;
+    if (strcmp(command, "dump") == 0) {
+        result = dump(file);
+    } else if (strcmp(command, "json") == 0) {
+        result = exportJson(file, output);
+    } else {
+        Si5351I2cTransport i2c;
+        Si5351Simulator simulator(busHz);
+        Si5351Transport *transport = &simulator;
+        if (!simulate) {
+            if (i2c.open() == -1) {
+                si5351FreeTrace(&file);
+                return 1;
+            }
+            transport = &i2c;
+        }
+        result = replay(file, transport, speed);
+    }
+    if (result != 0) {
+        fprintf(stderr, "%s: stopped at a corrupt record or a failed transfer\n", path);
+    }
+    si5351FreeTrace(&file);
+    return result;
+}
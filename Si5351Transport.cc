@@ -0,0 +1,342 @@
+/*
+ * SI5351 I2C transport
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Si5351Transport.h"
+
+/**
+ * Report a failed system call like perror(). The freestanding build
+ * (SI5351_FREESTANDING) has no stdio, so it writes to file descriptor 2.
+ */
+static void reportError(const char *what) {
+#ifdef SI5351_FREESTANDING
+    const char *reason = strerror(errno);
+
+    // Nothing more can be done if standard error is gone
+    if (write(2, what, strlen(what)) < 0 || write(2, ": ", 2) < 0 || write(2, reason, strlen(reason)) < 0 || write(2, "\n", 1) < 0) {
+        return;
+    }
+#else
+    perror(what);
+#endif
+}
+
+/**
+ * Initialize the I2C bus and set the target device address.
+ *
+ * @param deviceAddress The address of the I2C device.
+ * @param device The I2C bus device node.
+ * @return File descriptor for the I2C bus, or -1 on failure.
+ */
+int wiringPiI2CSetup(int deviceAddress, const char *device) {
+    int file;
+
+    // Open the I2C bus
+    if ((file = open(device, O_RDWR)) < 0) {
+        reportError("Failed to open the I2C bus");
+        return -1;
+    }
+
+    // Set the I2C slave address
+    if (ioctl(file, I2C_SLAVE, deviceAddress) < 0) {
+        reportError("Failed to set I2C slave address");
+        close(file);
+        return -1;
+    }
+
+    return file;
+}
+
+/**
+ * Write an 8-bit value to a specific register on the I2C device.
+ *
+ * @param file File descriptor of the I2C bus (returned by wiringPiI2CSetup).
+ * @param reg The register address to write to.
+ * @param value The 8-bit value to write.
+ * @return 0 on success, -1 on failure.
+ */
+int wiringPiI2CWriteReg8(int file, uint8_t reg, uint8_t value) {
+    uint8_t buffer[2];
+    buffer[0] = reg;    // Register address
+    buffer[1] = value;  // Value to write
+
+    // Write the register address and value to the I2C device
+    if (write(file, buffer, 2) != 2) {
+        reportError("Failed to write to I2C device");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Write a contiguous run of registers on the I2C device in one transaction.
+ * The Si5351 auto-increments its register pointer after every data byte.
+ *
+ * @param file File descriptor of the I2C bus (returned by wiringPiI2CSetup).
+ * @param reg The first register address to write to.
+ * @param data The values to write, one per register.
+ * @param length The number of registers to write (at most I2C_MAX_BURST).
+ * @return 0 on success, -1 on failure.
+ */
+int wiringPiI2CWriteBlock(int file, uint8_t reg, const uint8_t *data, int length) {
+    uint8_t buffer[I2C_MAX_BURST + 1];
+
+    if (length < 1 || length > I2C_MAX_BURST) {
+        return -1;
+    }
+
+    buffer[0] = reg;    // First register address
+    memcpy(buffer + 1, data, length);
+
+    if (write(file, buffer, length + 1) != length + 1) {
+        reportError("Failed to write to I2C device");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Carry out a combined transfer with ioctl(I2C_RDWR) (one STOP only). If
+ * the adapter does not support I2C_RDWR (ENOTTY, EOPNOTSUPP or EINVAL),
+ * every message is sent on its own with write() or read() instead. Any
+ * other error, such as a NACK part-way through, fails the transfer.
+ *
+ * @param file File descriptor of the I2C bus (returned by wiringPiI2CSetup).
+ * @param messages The messages, in the order they must reach the chip.
+ * @param count The number of messages.
+ * @param syscalls If not nullptr, incremented by the number of system calls made.
+ * @return 0 on success, -1 on failure.
+ */
+int wiringPiI2CTransfer(int file, struct i2c_msg *messages, int count, uint32_t *syscalls) {
+    uint32_t ignored;
+    struct i2c_rdwr_ioctl_data transfer;
+    transfer.msgs = messages;
+    transfer.nmsgs = count;
+
+    if (syscalls == nullptr) {
+        syscalls = &ignored;
+    }
+
+    ++*syscalls;
+    if (ioctl(file, I2C_RDWR, &transfer) >= 0) {
+        return 0;
+    }
+
+    // A NACK or timeout may have applied part of the transfer; let the caller retry it whole
+    if (errno != ENOTTY && errno != EOPNOTSUPP && errno != EINVAL) {
+        reportError("Failed to transfer to I2C device");
+        return -1;
+    }
+
+    // The adapter has no I2C_RDWR: fall back to one write() or read() per message
+    for (int i = 0; i < count; i++) {
+        ++*syscalls;
+        ssize_t done = (messages[i].flags & I2C_M_RD) ? read(file, messages[i].buf, messages[i].len)
+                                                      : write(file, messages[i].buf, messages[i].len);
+        if (done != messages[i].len) {
+            reportError("Failed to transfer to I2C device");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * What one transfer carries for each phase.
+ */
+struct Si5351Transport::Account {
+    uint16_t phases;                        // bit per phase touched
+    uint32_t messages[SI5351_PHASE_COUNT];
+    uint32_t bytes[SI5351_PHASE_COUNT];
+    uint64_t wireBits[SI5351_PHASE_COUNT];
+};
+
+uint64_t monotonicNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+int Si5351Transport::run(struct i2c_msg *messages, int count, const Account &account) {
+    uint64_t start = stats || trace ? monotonicNs() : 0;
+    uint32_t syscallsBefore = syscalls;
+    int attempts = 0;
+    int result;
+
+    do {
+        result = transfer(messages, count);
+        attempts++;
+    } while (result == -1 && attempts <= SI5351_TRANSFER_RETRIES);
+
+    if (stats == nullptr && trace == nullptr) {
+        return result;
+    }
+    uint64_t end = monotonicNs();
+    if (trace != nullptr) {
+        si5351TraceTransfer(trace, start, end, messages, count, attempts, result);
+    }
+    if (stats == nullptr) {
+        return result;
+    }
+
+    uint64_t wallNs = end - start;
+    uint64_t bits = si5351WireBits(messages, count);
+    auto add = [&](Si5351PhaseStats &phase, uint32_t messageCount, uint32_t byteCount, uint64_t wireBits, uint64_t wall) {
+        phase.syscalls += syscalls - syscallsBefore;
+        phase.transfers++;
+        phase.messages += messageCount;
+        phase.bytes += byteCount;
+        phase.retries += attempts - 1;
+        phase.failures += result == -1;
+        phase.wireBits += wireBits * attempts;
+        phase.wallNs += wall;
+    };
+
+    uint32_t byteCount = 0;
+    for (int i = 0; i < count; i++) {
+        byteCount += messages[i].len;
+    }
+    add(stats->total, count, byteCount, bits, wallNs);
+    for (int i = 0; i < SI5351_PHASE_COUNT; i++) {
+        if (account.phases & (1 << i)) {
+            add(stats->phases[i], account.messages[i], account.bytes[i], account.wireBits[i],
+                wallNs * account.wireBits[i] / bits);
+        }
+    }
+
+    return result;
+}
+
+int Si5351Transport::writeBlocks(const RegisterBlock *blocks, int count) {
+    uint8_t buffer[I2C_MAX_MESSAGES * (I2C_MAX_BURST + 1)];
+    struct i2c_msg messages[I2C_MAX_MESSAGES];
+    int messageCount = 0;
+    uint8_t *next = buffer;
+    int nextReg = -1;
+    Account account = {};
+    uint8_t messagePhases = 0;
+
+    for (int i = 0; i < count; i++) {
+        const RegisterBlock &block = blocks[i];
+        uint8_t phase = block.phase;
+
+        if (block.length > I2C_MAX_BURST) {
+            return -1;
+        }
+
+        // Continue the previous message if the register pointer is already there
+        if (block.reg == nextReg && messages[messageCount - 1].len + block.length <= I2C_MAX_BURST + 1) {
+            messages[messageCount - 1].len += block.length;
+        } else {
+            // (Repeated) START, address and register pointer
+            account.bytes[phase]++;
+            account.wireBits[phase] += 1 + 9 + 9;
+            messagePhases = 0;
+
+            if (messageCount == I2C_MAX_MESSAGES) {
+                return -1;
+            }
+            messages[messageCount].addr = deviceAddress;
+            messages[messageCount].flags = 0;
+            messages[messageCount].len = block.length + 1;
+            messages[messageCount].buf = next;
+            *next++ = block.reg;
+            messageCount++;
+        }
+        if (!(messagePhases & (1 << phase))) {
+            messagePhases |= 1 << phase;
+            account.messages[phase]++;
+        }
+        account.phases |= 1 << phase;
+        account.bytes[phase] += block.length;
+        account.wireBits[phase] += 9 * block.length;
+        memcpy(next, block.data, block.length);
+        next += block.length;
+        nextReg = block.reg + block.length;
+    }
+    if (count > 0) {
+        account.wireBits[blocks[count - 1].phase] += 1;    // STOP
+    }
+
+    return run(messages, messageCount, account) == -1 ? -1 : messageCount;
+}
+
+int Si5351Transport::writeRegister(uint8_t reg, uint8_t value) {
+    const RegisterBlock block = { reg, 1, &value };
+    return writeBlocks(&block, 1) == -1 ? -1 : 0;
+}
+
+int Si5351Transport::readBlock(uint8_t reg, uint8_t *data, int length, uint8_t phase) {
+    const RegisterRead read = { reg, (uint8_t)length, data };
+    return readBlocks(&read, 1, phase) == -1 ? -1 : 0;
+}
+
+int Si5351Transport::readBlocks(const RegisterRead *reads, int count, uint8_t phase) {
+    const int perTransfer = I2C_MAX_MESSAGES / 2;
+    struct i2c_msg messages[I2C_MAX_MESSAGES];
+    uint8_t pointers[I2C_MAX_MESSAGES / 2];
+    int transfers = 0;
+
+    for (int first = 0; first < count; first += perTransfer) {
+        int runs = count - first < perTransfer ? count - first : perTransfer;
+        Account account = {};
+        account.phases = 1 << phase;
+
+        for (int i = 0; i < runs; i++) {
+            const RegisterRead &read = reads[first + i];
+            pointers[i] = read.reg;
+            messages[2 * i].addr = deviceAddress;
+            messages[2 * i].flags = 0;
+            messages[2 * i].len = 1;
+            messages[2 * i].buf = &pointers[i];
+            messages[2 * i + 1].addr = deviceAddress;
+            messages[2 * i + 1].flags = I2C_M_RD;
+            messages[2 * i + 1].len = read.length;
+            messages[2 * i + 1].buf = read.data;
+            account.bytes[phase] += 1 + read.length;
+        }
+        account.messages[phase] = 2 * runs;
+        account.wireBits[phase] = si5351WireBits(messages, 2 * runs);
+
+        if (run(messages, 2 * runs, account) == -1) {
+            return -1;
+        }
+        transfers++;
+    }
+
+    return transfers;
+}
+
+Si5351I2cTransport::~Si5351I2cTransport() {
+    if (file >= 0) {
+        ::close(file);
+    }
+}
+
+int Si5351I2cTransport::open(const char *device, int address) {
+    file = wiringPiI2CSetup(address, device);
+    deviceAddress = address;
+    return file < 0 ? -1 : 0;
+}
+
+int Si5351I2cTransport::transfer(struct i2c_msg *messages, int count) {
+    return wiringPiI2CTransfer(file, messages, count, &syscalls);
+}
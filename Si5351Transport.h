@@ -0,0 +1,146 @@
+/*
+ * SI5351 I2C transport
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Register access used by every mode of the program. Register blocks
+ *   are turned into I2C messages here; a transport only has to carry one
+ *   combined transfer (repeated STARTs, one STOP). The i2c-dev transport
+ *   talks to the chip through /dev/i2c-N, the simulator transport models
+ *   the chip and the bus in software (Si5351Simulator.h).
+ */
+
+#ifndef SI5351_TRANSPORT_H
+#define SI5351_TRANSPORT_H
+
+#include <linux/i2c.h>
+#include <stdint.h>
+
+#include "Si5351Registers.h"
+#include "Si5351Stats.h"
+#include "Si5351Trace.h"
+
+#define I2C_MAX_BURST 96
+#define I2C_MAX_MESSAGES 8
+
+// Extra attempts for a transfer that fails
+#define SI5351_TRANSFER_RETRIES 2
+
+/**
+ * A run of consecutive registers to be programmed.
+ */
+struct RegisterBlock {
+    uint8_t reg;
+    uint8_t length;
+    const uint8_t *data;
+    uint8_t phase = SI5351_PHASE_OTHER;     // for the statistics
+};
+
+/**
+ * A run of consecutive registers to be read.
+ */
+struct RegisterRead {
+    uint8_t reg;
+    uint8_t length;
+    uint8_t *data;
+};
+
+int wiringPiI2CSetup(int deviceAddress, const char *device = I2C_DEVICE);
+int wiringPiI2CWriteReg8(int file, uint8_t reg, uint8_t value);
+int wiringPiI2CWriteBlock(int file, uint8_t reg, const uint8_t *data, int length);
+int wiringPiI2CTransfer(int file, struct i2c_msg *messages, int count, uint32_t *syscalls = nullptr);
+
+/**
+ * CLOCK_MONOTONIC in nanoseconds, for deadlines and timings.
+ */
+uint64_t monotonicNs();
+
+/**
+ * Register access to one Si5351.
+ */
+class Si5351Transport {
+public:
+    explicit Si5351Transport(int address = SI5351_ADDRESS) : stats(nullptr), trace(nullptr), deviceAddress(address), syscalls(0) {}
+    virtual ~Si5351Transport() {}
+
+    /**
+     * Carry out one combined transfer: every message starts with a
+     * (repeated) START, the last one ends with a STOP.
+     *
+     * @return 0 on success, -1 on failure.
+     */
+    virtual int transfer(struct i2c_msg *messages, int count) = 0;
+
+    /**
+     * Write register blocks in order as one transfer. Blocks that continue
+     * where the previous one ended are merged into the same message. A
+     * failed transfer is retried up to SI5351_TRANSFER_RETRIES times.
+     *
+     * @return Number of I2C messages sent, or -1 on failure.
+     */
+    int writeBlocks(const RegisterBlock *blocks, int count);
+
+    /**
+     * Write a single register.
+     *
+     * @return 0 on success, -1 on failure.
+     */
+    int writeRegister(uint8_t reg, uint8_t value);
+
+    /**
+     * Read consecutive registers in one combined write-then-read transfer.
+     *
+     * @param phase The phase to count the transfer under in the statistics.
+     * @return 0 on success, -1 on failure.
+     */
+    int readBlock(uint8_t reg, uint8_t *data, int length, uint8_t phase = SI5351_PHASE_OTHER);
+
+    /**
+     * Read several register runs, each as a register pointer write and a
+     * read, I2C_MAX_MESSAGES / 2 runs per combined transfer.
+     *
+     * @param phase The phase to count the transfers under in the statistics.
+     * @return Number of transfers made, or -1 on failure.
+     */
+    int readBlocks(const RegisterRead *reads, int count, uint8_t phase = SI5351_PHASE_OTHER);
+
+    // Counters to update, or nullptr
+    Si5351BusStats *stats;
+
+    // Ring buffer to record every transfer into, or nullptr
+    Si5351Trace *trace;
+
+protected:
+    int deviceAddress;
+    uint32_t syscalls;          // kept by transports that make system calls
+
+private:
+    struct Account;
+
+    int run(struct i2c_msg *messages, int count, const Account &account);
+};
+
+/**
+ * Transport over the Linux i2c-dev interface.
+ */
+class Si5351I2cTransport : public Si5351Transport {
+public:
+    Si5351I2cTransport() : file(-1) {}
+    ~Si5351I2cTransport();
+
+    /**
+     * Open the I2C bus and select the device.
+     *
+     * @return 0 on success, -1 on failure.
+     */
+    int open(const char *device = I2C_DEVICE, int address = SI5351_ADDRESS);
+
+    int transfer(struct i2c_msg *messages, int count) override;
+
+private:
+    int file;
+};
+
+#endif // SI5351_TRANSPORT_H
@@ -0,0 +1,63 @@
+/*
+ * SI5351 fine trim
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <math.h>
+
+#include "Si5351Trim.h"
+
+/**
+ * Offset in ppb of PLL A with the given P2 from the base divider.
+ */
+static double offsetPpb(const Si5351Parameters &base, uint32_t p2) {
+    double baseValue = base.p1 + 512 + (double)base.p2 / base.p3;
+    return ((int64_t)p2 - (int64_t)base.p2) / (double)base.p3 / baseValue * 1e9;
+}
+
+void si5351TrimInit(const Si5351RegisterImage &image, Si5351Trim *trim) {
+    trim->base = si5351Unpack(image.pll);
+    trim->p2 = trim->base.p2;
+    trim->ppb = 0;
+    trim->ppbPerStep = offsetPpb(trim->base, trim->base.p2 + 1);
+    trim->minPpb = offsetPpb(trim->base, 0);
+    trim->maxPpb = offsetPpb(trim->base, trim->base.p3 - 1);
+    trim->updates = 0;
+    trim->registers = 0;
+}
+
+int si5351Trim(Si5351Transport *transport, Si5351Trim *trim, double ppb) {
+    const Si5351Parameters &base = trim->base;
+
+    // P1 + 512 + P2/P3 scaled by (1 + ppb), with P1 and P3 fixed
+    double target = (base.p1 + 512 + (double)base.p2 / base.p3) * (1 + ppb * 1e-9);
+    double p2 = round((target - base.p1 - 512) * base.p3);
+    if (!(p2 >= 0 && p2 < base.p3)) {
+        return -1;
+    }
+    uint32_t next = (uint32_t)p2;
+    if (next == trim->p2) {
+        trim->ppb = offsetPpb(base, next);
+        return 0;
+    }
+
+    // Registers 31-33: P3[19:16] and P2[19:16], P2[15:8], P2[7:0]
+    uint8_t old[3] = { (uint8_t)(((base.p3 >> 12) & 0xF0) | ((trim->p2 >> 16) & 0x0F)), (uint8_t)(trim->p2 >> 8), (uint8_t)trim->p2 };
+    uint8_t bytes[3] = { (uint8_t)(((base.p3 >> 12) & 0xF0) | ((next >> 16) & 0x0F)), (uint8_t)(next >> 8), (uint8_t)next };
+    int first = 0;
+    while (old[first] == bytes[first]) {
+        first++;
+    }
+
+    const RegisterBlock block = { (uint8_t)(SI5351_REGISTER_31_PLL_A_REG5 + first), (uint8_t)(3 - first), bytes + first, SI5351_PHASE_PLL };
+    if (transport->writeBlocks(&block, 1) == -1) {
+        return -1;
+    }
+    trim->p2 = next;
+    trim->ppb = offsetPpb(base, next);
+    trim->updates++;
+    trim->registers += 3 - first;
+    return 3 - first;
+}
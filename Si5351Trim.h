@@ -0,0 +1,59 @@
+/*
+ * SI5351 fine trim
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Pulls CLK0 by a few ppb to ppm without a glitch, e.g. to genlock the
+ *   Atari's video clock to an external reference. The PLL A feedback
+ *   divider is (P1 + 512 + P2/P3) / 128; a trim keeps P1 and P3 and
+ *   recomputes only P2, so at most registers 31-33 change and they are
+ *   written as one burst with no PLL reset. The MultiSynth divider is
+ *   untouched, so the output moves by the same ppb as the VCO.
+ *
+ *   One step of P2 moves the output by 1e9 / (P3 * (P1 + 512 + P2/P3))
+ *   ppb, and P2 must stay below P3, so the resolution and the range
+ *   depend on the preset's feedback denominator.
+ */
+
+#ifndef SI5351_TRIM_H
+#define SI5351_TRIM_H
+
+#include <stdint.h>
+
+#include "Si5351Solver.h"
+#include "Si5351Transport.h"
+
+struct Si5351Trim {
+    Si5351Parameters base;      // PLL A at trim 0
+    uint32_t p2;                // P2 in the chip
+    double ppb;                 // offset in the chip
+    double ppbPerStep;          // one step of P2 at trim 0
+    double minPpb;              // P2 = 0
+    double maxPpb;              // P2 = P3 - 1
+    uint32_t updates;           // trims that wrote registers
+    uint32_t registers;         // registers written
+};
+
+/**
+ * Start trimming a CLK0 image the chip has been programmed with.
+ *
+ * @param image The programmed register image (trim 0).
+ * @param trim Receives the base divider, resolution and range.
+ */
+void si5351TrimInit(const Si5351RegisterImage &image, Si5351Trim *trim);
+
+/**
+ * Move CLK0 to an offset from the programmed frequency. Only the bytes of
+ * registers 31-33 that change are written, in one message.
+ *
+ * @param transport The bus to the chip.
+ * @param trim The trim state; receives the new P2 and achieved offset.
+ * @param ppb The offset in parts per billion (absolute, not added to the last one).
+ * @return Number of registers written (0 if P2 did not change), or -1 if
+ *         the offset is outside minPpb..maxPpb or on bus failure.
+ */
+int si5351Trim(Si5351Transport *transport, Si5351Trim *trim, double ppb);
+
+#endif // SI5351_TRIM_H
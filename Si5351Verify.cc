@@ -0,0 +1,67 @@
+/*
+ * SI5351 register read-back verification
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include "Si5351Verify.h"
+
+int si5351Verify(Si5351Transport *transport, const Si5351RegisterMap &map, Si5351Verification *result) {
+    uint8_t actual[256];
+    RegisterRead reads[128];
+    int readCount = 0;
+
+    result->registers = 0;
+    result->transfers = 0;
+    result->mismatchCount = 0;
+    result->repaired = 0;
+    result->pllReset = false;
+
+    // One read per run of defined registers, at most I2C_MAX_BURST long
+    for (int reg = 0; reg < 256; reg++) {
+        if (!si5351MapDefined(map, reg)) {
+            continue;
+        }
+        if (readCount > 0 && reads[readCount - 1].reg + reads[readCount - 1].length == reg &&
+            reads[readCount - 1].length < I2C_MAX_BURST) {
+            reads[readCount - 1].length++;
+        } else {
+            reads[readCount++] = RegisterRead{ (uint8_t)reg, 1, actual + reg };
+        }
+        result->registers++;
+    }
+
+    int transfers = transport->readBlocks(reads, readCount, SI5351_PHASE_VERIFY);
+    if (transfers == -1) {
+        return -1;
+    }
+    result->transfers = transfers;
+
+    for (int reg = 0; reg < 256; reg++) {
+        if (si5351MapDefined(map, reg) && actual[reg] != map.values[reg]) {
+            result->mismatches[result->mismatchCount++] = Si5351Mismatch{ (uint8_t)reg, map.values[reg], actual[reg] };
+        }
+    }
+    return result->mismatchCount;
+}
+
+int si5351Repair(Si5351Transport *transport, const Si5351RegisterMap &map, Si5351Lock *lock, Si5351Verification *result) {
+    static Si5351RegisterMap current;
+    Si5351Update update;
+
+    // What the chip holds: the intended map, except where the read-back differed
+    current = map;
+    for (int i = 0; i < result->mismatchCount; i++) {
+        current.values[result->mismatches[i].reg] = result->mismatches[i].actual;
+    }
+    if (si5351UpdateRegisters(transport, &current, map, lock, &update) == -1) {
+        return -1;
+    }
+
+    int left = si5351Verify(transport, map, result);
+    result->transfers += update.transfers;
+    result->repaired = update.written;
+    result->pllReset = update.pllReset;
+    return left;
+}
@@ -0,0 +1,66 @@
+/*
+ * SI5351 register read-back verification
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Reads back every register a configuration defines and compares it
+ *   with the intended value. Each contiguous run is read with one
+ *   register pointer write and one read, and the runs share combined
+ *   transfers, so a CLK0 configuration (3, 16-33, 42-49) is verified in
+ *   a single transfer.
+ *
+ *   Repair hands the registers that differ to si5351UpdateRegisters() as
+ *   a delta, so they are written in the same order as any other update:
+ *   if a PLL register is bad, the outputs are disabled, the registers
+ *   rewritten, that PLL reset and waited for before the output enable.
+ *   The image is then read back once more.
+ */
+
+#ifndef SI5351_VERIFY_H
+#define SI5351_VERIFY_H
+
+#include <stdint.h>
+
+#include "Si5351Configuration.h"
+#include "Si5351Transport.h"
+
+struct Si5351Mismatch {
+    uint8_t reg;
+    uint8_t expected;
+    uint8_t actual;
+};
+
+struct Si5351Verification {
+    int registers;              // registers compared
+    int transfers;              // read and write transfers made
+    int mismatchCount;
+    Si5351Mismatch mismatches[256];
+    int repaired;               // registers rewritten
+    bool pllReset;
+};
+
+/**
+ * Read back and compare every register the map defines.
+ *
+ * @param transport The bus to the chip.
+ * @param map The intended register values.
+ * @param result Receives the mismatches and counters.
+ * @return Number of mismatches, or -1 on bus failure.
+ */
+int si5351Verify(Si5351Transport *transport, const Si5351RegisterMap &map, Si5351Verification *result);
+
+/**
+ * Rewrite the registers a previous si5351Verify() found wrong, then
+ * verify again.
+ *
+ * @param transport The bus to the chip.
+ * @param map The intended register values.
+ * @param lock If not nullptr and its deadline is set, wait for lock after a PLL reset.
+ * @param result The previous verification; receives the new one.
+ * @return Number of mismatches left, or -1 on bus failure or lock timeout.
+ */
+int si5351Repair(Si5351Transport *transport, const Si5351RegisterMap &map, Si5351Lock *lock, Si5351Verification *result);
+
+#endif // SI5351_VERIFY_H
@@ -0,0 +1,214 @@
+/*
+ * SI5351 clock config file watcher
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Si5351Presets.h"
+#include "Si5351Watch.h"
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+    stopRequested = 1;
+}
+
+static uint64_t realtimeNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+int si5351LoadClockConfig(const char *path, Si5351RegisterMap *map, char *summary, size_t size) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        perror("Failed to open the clock config");
+        return -1;
+    }
+
+    const char *names[SI5351_PLAN_MAX_OUTPUTS];
+    char tokens[SI5351_PLAN_MAX_OUTPUTS][32];
+    uint64_t outputMilliHz[SI5351_PLAN_MAX_OUTPUTS];
+    const Si5351Preset *preset = nullptr;
+    int count = 0;
+    int result = 0;
+    char line[256];
+    while (result == 0 && fgets(line, sizeof(line), file) != nullptr) {
+        char *comment = strchr(line, '#');
+        if (comment != nullptr) {
+            *comment = '\0';
+        }
+        for (char *token = strtok(line, ", \t\r\n"); token != nullptr && result == 0; token = strtok(nullptr, ", \t\r\n")) {
+            if (count == SI5351_PLAN_MAX_OUTPUTS || strlen(token) >= sizeof(tokens[0])) {
+                result = -1;
+                break;
+            }
+            preset = si5351FindPreset(token);
+            if (preset != nullptr) {
+                outputMilliHz[count] = preset->outputMilliHz;
+            } else if (si5351ParseMilliHz(token, &outputMilliHz[count]) == -1) {
+                result = -1;
+                break;
+            }
+            strcpy(tokens[count], token);
+            names[count] = tokens[count];
+            count++;
+        }
+    }
+    fclose(file);
+    if (result == -1 || count == 0) {
+        fprintf(stderr, "%s: expected up to %d preset names or frequencies in Hz\n", path, SI5351_PLAN_MAX_OUTPUTS);
+        return -1;
+    }
+
+    // One output is programmed like the command line: the preset's exact
+    // image, or the solver's; several go through the planner
+    if (count == 1) {
+        Si5351Solution solution;
+        if (preset != nullptr) {
+            si5351MapClock0(preset->image, 0x00, map);
+        } else if (si5351SolveFrequency(outputMilliHz[0], SI5351_XTAL_FREQUENCY, 0, &solution) == 0) {
+            si5351MapClock0(solution.image, 0x00, map);
+        } else {
+            result = -1;
+        }
+    } else {
+        static Si5351Plan plan;
+        if (si5351Plan(outputMilliHz, count, SI5351_XTAL_FREQUENCY, &plan) == 0) {
+            si5351MapPlan(plan, map);
+        } else {
+            result = -1;
+        }
+    }
+    if (result == -1) {
+        fprintf(stderr, "%s: no solution for these outputs\n", path);
+        return -1;
+    }
+
+    size_t length = 0;
+    summary[0] = '\0';
+    for (int i = 0; i < count && length < size; i++) {
+        length += snprintf(summary + length, size - length, "%sCLK%d %s", i == 0 ? "" : ", ", i, names[i]);
+    }
+    return 0;
+}
+
+/**
+ * Solve the config file and bring the chip to it, then report what was
+ * written and how long after the save the new clock was running.
+ */
+static void reload(Si5351Transport *transport, const char *path, Si5351RegisterMap *current, uint32_t lockDeadlineUs) {
+    static Si5351RegisterMap target;
+    char summary[160];
+    struct stat status;
+
+    uint64_t eventNs = realtimeNs();
+    if (stat(path, &status) < 0 || si5351LoadClockConfig(path, &target, summary, sizeof(summary)) == -1) {
+        printf("%s: not reloaded, the clock is unchanged\n", path);
+        fflush(stdout);
+        return;
+    }
+    uint64_t savedNs = (uint64_t)status.st_mtim.tv_sec * 1000000000ULL + status.st_mtim.tv_nsec;
+
+    Si5351Lock lock = {};
+    lock.deadlineUs = lockDeadlineUs;
+    Si5351Update update;
+    int result = si5351UpdateRegisters(transport, current, target, &lock, &update);
+    uint64_t doneNs = realtimeNs();
+
+    if (result == -1) {
+        if (lock.timedOut) {
+            printf("%s: PLL not locked after %u us (status %02Xh), outputs left disabled\n", path, lock.lockUs, lock.status);
+        } else {
+            printf("%s: register write failed, the next reload rewrites every register\n", path);
+        }
+    } else if (update.changed == 0) {
+        printf("%s: %s, no register changed\n", path, summary);
+    } else {
+        char locked[48] = "";
+        if (lock.locked) {
+            snprintf(locked, sizeof(locked), ", lock %u us", lock.lockUs);
+        }
+        printf("%s: %s, %d registers changed, %d written in %d message(s) / %d transfer(s), %s%s, "
+               "%.0f us from save (%.0f us from event)\n",
+               path, summary, update.changed, update.written, update.messages, update.transfers,
+               update.pllReset ? "PLL reset" : "no PLL reset", locked,
+               doneNs > savedNs ? (doneNs - savedNs) / 1000.0 : 0.0, (doneNs - eventNs) / 1000.0);
+    }
+    fflush(stdout);
+}
+
+int si5351Watch(Si5351Transport *transport, const char *path, uint32_t lockDeadlineUs) {
+    static Si5351RegisterMap current;
+
+    // Watch the directory: a save through rename() replaces the file's inode
+    char directory[PATH_MAX];
+    const char *slash = strrchr(path, '/');
+    const char *name = slash != nullptr ? slash + 1 : path;
+    if (slash == nullptr) {
+        strcpy(directory, ".");
+    } else if (slash == path) {
+        strcpy(directory, "/");
+    } else {
+        snprintf(directory, sizeof(directory), "%.*s", (int)(slash - path), path);
+    }
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        perror("Failed to watch the clock config");
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+
+    // Nothing is known about the chip yet, so the first load writes everything
+    memset(&current, 0, sizeof(current));
+    reload(transport, path, &current, lockDeadlineUs);
+
+    while (!stopRequested) {
+        struct pollfd watched = { fd, POLLIN, 0 };
+        if (poll(&watched, 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+
+        // One reload for every burst of events that names the file
+        alignas(struct inotify_event) char events[4096];
+        bool changed = false;
+        ssize_t length;
+        while ((length = read(fd, events, sizeof(events))) > 0) {
+            for (char *next = events; next < events + length;) {
+                const struct inotify_event *event = (const struct inotify_event *)next;
+                if (event->len > 0 && strcmp(event->name, name) == 0) {
+                    changed = true;
+                }
+                next += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (changed) {
+            reload(transport, path, &current, lockDeadlineUs);
+        }
+    }
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * SI5351 clock config file watcher
+ *
+ * Author: Piotr D. Kaczorowski
+ * Organization: THEATARIAN.COM
+ *
+ * Description:
+ *   Keeps the bus open and reprograms the chip whenever a clock config
+ *   file is saved. The file lists the outputs in order, CLK0 first, as
+ *   preset names or frequencies in Hz separated by commas, blanks or
+ *   newlines; "#" starts a comment:
+ *
+ *     # PAL machine
+ *     3.579545                 CLK0 only, like the command line
+ *     1773447, 14187576        CLK0 and CLK1 through the planner
+ *
+ *   The directory is watched with inotify, so editors that save through
+ *   a temporary file and rename() are seen as well. On each save the
+ *   file is solved again and only the registers that differ from what
+ *   the chip holds are written; the PLLs are reset only if a PLL
+ *   register changed. The latency from the file's modification time to
+ *   the new clock is reported for each reload.
+ */
+
+#ifndef SI5351_WATCH_H
+#define SI5351_WATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Si5351Configuration.h"
+#include "Si5351Transport.h"
+
+/**
+ * Solve a clock config file.
+ *
+ * @param path The config file.
+ * @param map Receives the register map to program.
+ * @param summary Receives a one-line description of the outputs.
+ * @param size Size of summary.
+ * @return 0 on success, -1 if the file cannot be read or solved.
+ */
+int si5351LoadClockConfig(const char *path, Si5351RegisterMap *map, char *summary, size_t size);
+
+/**
+ * Program a clock config file, then reprogram it on every save until
+ * SIGINT or SIGTERM.
+ *
+ * @param transport The bus to the chip, kept open while watching.
+ * @param path The config file.
+ * @param lockDeadlineUs How long to wait for lock after a PLL reset, 0 = do not wait.
+ * @return 0 on clean shutdown, -1 if the file cannot be watched.
+ */
+int si5351Watch(Si5351Transport *transport, const char *path, uint32_t lockDeadlineUs);
+
+#endif // SI5351_WATCH_H